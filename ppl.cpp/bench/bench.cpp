@@ -0,0 +1,398 @@
+#pragma once
+#include "common.cpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/// Allocations made through operator new since startup, arena blocks
+/// come from malloc and are not counted
+std::atomic<usize> allocation_count = 0;
+std::atomic<usize> allocated_bytes = 0;
+
+}; // namespace bench
+
+void * operator new(std::size_t size) {
+	bench::allocation_count.fetch_add(1, std::memory_order_relaxed);
+	bench::allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	void * pointer = std::malloc(size == 0 ? 1 : size);
+	if (pointer == nullptr) {
+		std::abort();
+	}
+	return pointer;
+}
+
+void operator delete(void * pointer) noexcept { std::free(pointer); }
+
+void operator delete(void * pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+namespace bench {
+
+/// Runs `fn` `repetitions` times and returns the fastest run in seconds
+template <typename F> double best_of(usize repetitions, F && fn) {
+	double best = 0;
+	for (usize i = 0; i < repetitions; ++i) {
+		auto begin = std::chrono::steady_clock::now();
+		fn();
+		auto end = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(end - begin).count();
+		if (i == 0 or seconds < best) {
+			best = seconds;
+		}
+	}
+	return best;
+}
+
+/// Keeps the computation of `value` from being optimized away
+template <typename T> void do_not_optimize(T const & value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Peak resident set of the process in bytes since the last
+/// reset_peak_rss, from VmHWM in /proc/self/status. 0 when unknown.
+usize peak_rss() {
+	FILE * status = fopen("/proc/self/status", "r");
+	if (status == nullptr) {
+		return 0;
+	}
+	char line[256];
+	usize kilobytes = 0;
+	while (fgets(line, sizeof(line), status) != nullptr) {
+		if (strncmp(line, "VmHWM:", 6) == 0) {
+			kilobytes = strtoull(line + 6, nullptr, 10);
+			break;
+		}
+	}
+	fclose(status);
+	return kilobytes * 1024;
+}
+
+/// Resets the peak resident set to the current one, so peak_rss
+/// measures a single phase
+void reset_peak_rss() {
+	FILE * clear_refs = fopen("/proc/self/clear_refs", "w");
+	if (clear_refs != nullptr) {
+		fputs("5", clear_refs);
+		fclose(clear_refs);
+	}
+}
+
+/// One benchmarked phase, counts are per run
+struct Measurement {
+	std::string name;
+	/// Input bytes, tokens and syntax nodes processed, 0 if not
+	/// relevant to the phase
+	usize bytes = 0;
+	usize tokens = 0;
+	usize nodes = 0;
+	/// Fastest run
+	double seconds = 0;
+	usize peak_rss = 0;
+	usize allocations = 0;
+	usize allocated_bytes = 0;
+};
+
+/// Runs `fn` `repetitions` times and measures it, `fn` fills in the
+/// counts of the measurement it is given
+template <typename F>
+Measurement measure(std::string name, usize repetitions, F && fn) {
+	Measurement measurement = {.name = std::move(name)};
+	reset_peak_rss();
+	usize count = allocation_count.load();
+	usize bytes = allocated_bytes.load();
+	measurement.seconds = best_of(repetitions, [&] { fn(measurement); });
+	measurement.allocations =
+		(allocation_count.load() - count) / repetitions;
+	measurement.allocated_bytes =
+		(allocated_bytes.load() - bytes) / repetitions;
+	measurement.peak_rss = peak_rss();
+	return measurement;
+}
+
+/// Throughput of a measurement in units per second
+double per_second(usize count, double seconds) {
+	return seconds > 0 ? (double)count / seconds : 0;
+}
+
+/// Results as a json document, one object per phase
+std::string to_json(
+	std::vector<Measurement> const & measurements,
+	usize corpus_size,
+	u64 seed
+) {
+	std::string json = std::format(
+		"{{\n  \"corpus\": {{\"bytes\": {}, \"seed\": {}}},\n"
+		"  \"phases\": [",
+		corpus_size,
+		seed
+	);
+	for (usize i = 0; i < measurements.size(); ++i) {
+		Measurement const & m = measurements[i];
+		json += std::format(
+			"{}\n    {{\"name\": \"{}\", \"bytes\": {}, \"tokens\": {}, "
+			"\"nodes\": {}, \"seconds\": {:.6f}, \"mb_per_s\": {:.2f}, "
+			"\"tokens_per_s\": {:.0f}, \"nodes_per_s\": {:.0f}, "
+			"\"peak_rss\": {}, \"allocations\": {}, "
+			"\"allocated_bytes\": {}}}",
+			i == 0 ? "" : ",",
+			m.name,
+			m.bytes,
+			m.tokens,
+			m.nodes,
+			m.seconds,
+			per_second(m.bytes, m.seconds) / 1e6,
+			per_second(m.tokens, m.seconds),
+			per_second(m.nodes, m.seconds),
+			m.peak_rss,
+			m.allocations,
+			m.allocated_bytes
+		);
+	}
+	json += "\n  ]\n}\n";
+	return json;
+}
+
+/// Small deterministic generator so corpora are identical across runs
+struct Random {
+	u64 state;
+
+	u64 next() {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return state >> 33;
+	}
+
+	usize below(usize bound) { return next() % bound; }
+};
+
+/// Appends generated .ppl lines to `corpus` until it reaches `size`
+/// bytes
+void generate_corpus(std::string & corpus, usize size, u64 seed) {
+	const char * const identifiers[] = {
+		"value", "count", "request", "x", "fn_result", "pipeline"
+	};
+	const char * const operators[] = {
+		" + ", " - ", " * ", " / ", " |> ", " .& ", " >= ", " and "
+	};
+	Random random = {.state = seed};
+
+	while (corpus.size() < size) {
+		corpus.append(random.below(4) * 4, ' ');
+		corpus += identifiers[random.below(6)];
+		corpus += std::to_string(random.below(1000));
+		corpus += ": ";
+		usize terms = 1 + random.below(6);
+		for (usize i = 0; i < terms; ++i) {
+			if (i != 0) {
+				corpus += operators[random.below(8)];
+			}
+			switch (random.below(4)) {
+			case 0:
+				corpus += std::to_string(random.next());
+				break;
+			case 1:
+				corpus += "0x1f_ff";
+				break;
+			default:
+				corpus += identifiers[random.below(6)];
+			}
+		}
+		if (random.below(4) == 0) {
+			corpus += "  // generated comment ";
+			corpus.append(random.below(40), '=');
+		}
+		corpus += '\n';
+	}
+}
+
+/// Appends generated .ppl lines mixing ascii code with multibyte
+/// string literals and comments to `corpus` until it reaches `size`
+/// bytes
+void generate_multibyte_corpus(std::string & corpus, usize size, u64 seed) {
+	const char * const texts[] = {
+		"héllo wörld", "naïve café", "漢字かな交じり", "приве́т", "🚀 ✓ ∑ → λ"
+	};
+	Random random = {.state = seed};
+
+	while (corpus.size() < size) {
+		std::string line;
+		generate_corpus(line, 1, random.next());
+		line.pop_back();
+		if (random.below(2) == 0) {
+			line += " |> \"";
+			line += texts[random.below(5)];
+			line += '"';
+		}
+		if (random.below(2) == 0) {
+			line += "  // ";
+			line += texts[random.below(5)];
+		}
+		corpus += line;
+		corpus += '\n';
+	}
+}
+
+/// Appends a deep binary expression with `depth` levels of operators
+/// and parentheses
+void generate_binary(
+	std::string & corpus, usize depth, Random & random
+) {
+	const char * const operators[] = {
+		" + ", " - ", " * ", " / ", " % ", " ^ ", " << ", " >> ",
+		" .& ", " .| ", " .^ ", " = ", " > ", " <= ", " and ", " or "
+	};
+	if (depth == 0) {
+		switch (random.below(5)) {
+		case 0:
+			corpus += std::to_string(random.below(100000));
+			break;
+		case 1:
+			corpus += std::format("0x{:x}", random.next());
+			break;
+		case 2:
+			corpus += std::format(
+				"{}.{}", random.below(1000), random.below(1000)
+			);
+			break;
+		default:
+			corpus += "value";
+			corpus += std::to_string(random.below(100));
+		}
+		return;
+	}
+	bool parenthesized = random.below(3) == 0;
+	if (parenthesized) {
+		corpus += '(';
+	}
+	generate_binary(corpus, random.below(depth), random);
+	corpus += operators[random.below(16)];
+	generate_binary(corpus, depth - 1, random);
+	if (parenthesized) {
+		corpus += ')';
+	}
+}
+
+/// Appends definitions made of one flat chain of `length` binary
+/// operators each, every precedence level mixed in, to `corpus` until
+/// it reaches `size` bytes
+void generate_operator_chains(
+	std::string & corpus, usize size, u64 seed, usize length
+) {
+	const char * const operators[] = {
+		" |> ", " or ", " and ", " = ", " >= ", " .| ", " .^ ", " .& ",
+		" << ", " + ", " - ", " * ", " / ", " ^ "
+	};
+	Random random = {.state = seed};
+	for (usize definition = 0; corpus.size() < size; ++definition) {
+		corpus += std::format("chain{}: x", definition);
+		for (usize i = 0; i < length; ++i) {
+			corpus += operators[random.below(std::size(operators))];
+			if (random.below(2) == 0) {
+				corpus += std::to_string(random.below(1000));
+			} else {
+				corpus += "value";
+			}
+		}
+		corpus += '\n';
+	}
+}
+
+/// Appends one expression nested `depth` levels deep, the way code
+/// generators nest: every level opens a parenthesis, a call argument,
+/// a pipe operand, a tagged parenthesis or a prefix operator, picked at
+/// random
+void generate_nesting(std::string & corpus, usize depth, u64 seed) {
+	const char * const opens[] = {"(", "f(", "x |> (", "(t: ", "-", "not "};
+	const char * const closes[] = {")", ")", ")", ")", "", ""};
+	Random random = {.state = seed};
+	std::vector<u8> levels(depth);
+	for (u8 & level : levels) {
+		level = (u8)random.below(std::size(opens));
+		corpus += opens[level];
+	}
+	corpus += "value";
+	for (usize level = depth; level-- > 0;) {
+		corpus += closes[levels[level]];
+	}
+	corpus += '\n';
+}
+
+/// Appends generated .ppl definitions to `corpus` until it reaches
+/// `size` bytes: tagged definitions of deep binary expressions,
+/// pipelines, literals in every base and comments, in the proportions
+/// of hand written code. Binary expressions nest at most `max_depth`
+/// levels.
+void generate_program(
+	std::string & corpus, usize size, u64 seed, usize max_depth = 12
+) {
+	const char * const functions[] = {
+		"map", "filter", "reduce", "parse", "format", "validate"
+	};
+	const char * const strings[] = {
+		"\"hello, world\"", "\"line\\n\"", "\"héllo wörld\"",
+		"\"\\u{1F680} launch\""
+	};
+	Random random = {.state = seed};
+
+	for (usize definition = 0; corpus.size() < size; ++definition) {
+		if (random.below(5) == 0) {
+			corpus += "// ";
+			corpus += functions[random.below(6)];
+			corpus += " the values of the previous definitions\n";
+		}
+		corpus += std::format("definition{}: ", definition);
+		switch (random.below(6)) {
+		case 0:
+		case 1:
+			generate_binary(corpus, 1 + random.below(max_depth), random);
+			break;
+		case 2: {
+			corpus += "value";
+			corpus += std::to_string(random.below(100));
+			for (usize i = 1 + random.below(5); i > 0; --i) {
+				corpus += "\n    |> ";
+				corpus += functions[random.below(6)];
+				corpus += std::format("({})", random.below(1000));
+			}
+			break;
+		}
+		case 3:
+			switch (random.below(4)) {
+			case 0:
+				corpus += std::format("0b{:b}", random.below(1 << 16));
+				break;
+			case 1:
+				corpus += std::format("0o{:o}", random.next());
+				break;
+			case 2:
+				corpus += std::format("1_000_{:03}", random.below(1000));
+				break;
+			default:
+				corpus += std::to_string(random.next() * random.next());
+			}
+			break;
+		case 4:
+			corpus += std::format(
+				"{}.{}e{}", random.below(10), random.below(100000),
+				(int)random.below(40) - 20
+			);
+			break;
+		default:
+			corpus += strings[random.below(4)];
+		}
+		if (random.below(8) == 0) {
+			corpus += "  // trailing comment";
+		}
+		corpus += '\n';
+	}
+}
+
+}; // namespace bench
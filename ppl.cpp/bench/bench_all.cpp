@@ -0,0 +1,50 @@
+#include "bench_ast.cpp"
+#include "bench_driver.cpp"
+#include "bench_literal.cpp"
+#include "bench_relex.cpp"
+#include "bench_suite.cpp"
+#include "bench_tokenizer.cpp"
+#include "bench_utf8.cpp"
+#include <cstdlib>
+#include <cstring>
+
+/// bench [--json] [--size MiB] [--seed n]
+///
+/// With --json only the phase suite runs and its results are printed
+/// as json, to be saved and compared between runs.
+int main(int argc, char ** argv) {
+	bool json = false;
+	usize size = 16;
+	u64 seed = 42;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--json") == 0) {
+			json = true;
+		} else if (strcmp(argv[i], "--size") == 0 and i + 1 < argc) {
+			size = strtoull(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "--seed") == 0 and i + 1 < argc) {
+			seed = strtoull(argv[++i], nullptr, 10);
+		} else {
+			std::println(
+				stderr, "usage: bench [--json] [--size MiB] [--seed n]"
+			);
+			return 1;
+		}
+	}
+
+	std::string corpus;
+	bench::generate_program(corpus, size << 20, seed);
+	auto measurements = bench_suite(corpus);
+	if (json) {
+		std::print("{}", bench::to_json(measurements, corpus.size(), seed));
+		return 0;
+	}
+	print_suite(measurements);
+
+	bench_tokenizer();
+	bench_utf8();
+	bench_relex();
+	bench_literal();
+	bench_driver();
+	bench_ast();
+	return 0;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "bench.cpp"
+#include "syntax/node_arena.cpp"
+#include "syntax/parser.cpp"
+#include <print>
+#include <vector>
+
+/// Builds random expression trees children first, as the parser does,
+/// through `push`. Returns the roots.
+template <typename Push>
+std::vector<syntax::NodeId<syntax::Expression>>
+generate_trees(usize node_count, Push && push) {
+	using namespace syntax;
+	const TokenKind operators[] = {
+		TokenKind::plus, TokenKind::times, TokenKind::pipe, TokenKind::band
+	};
+	bench::Random random = {.state = 5};
+	std::vector<NodeId<Expression>> roots;
+	std::vector<NodeId<Expression>> stack;
+	for (usize i = 0; i < node_count; ++i) {
+		if (stack.size() >= 2 and random.below(2) == 0) {
+			NodeId<Expression> rhs = stack.back();
+			stack.pop_back();
+			NodeId<Expression> lhs = stack.back();
+			stack.pop_back();
+			stack.push_back(
+				push(make_binary(operators[random.below(4)], lhs, rhs))
+			);
+		} else if (random.below(2) == 0) {
+			stack.push_back(push(make_int_literal(random.below(1000), i)));
+		} else {
+			stack.push_back(push(make_identifier(
+				{.offset = i, .symbol = (u32)random.below(100)}
+			)));
+		}
+		if (stack.size() > 64) {
+			roots.push_back(stack.front());
+			stack.erase(stack.begin());
+		}
+	}
+	roots.insert(roots.end(), stack.begin(), stack.end());
+	return roots;
+}
+
+/// Sum of the literals and symbols under `id`, a stand in for a pass
+/// over the tree
+u64 walk(
+	syntax::NodeArena const & arena,
+	syntax::NodeId<syntax::Expression> id
+) {
+	syntax::Expression const & expression = arena[id];
+	switch (expression.kind) {
+	case syntax::ExpressionKind::binary:
+		return walk(arena, expression.value.binary.lhs) +
+			   walk(arena, expression.value.binary.rhs);
+	case syntax::ExpressionKind::int_literal:
+		return expression.value.int_literal.value;
+	case syntax::ExpressionKind::identifier:
+		return expression.value.identifier.symbol;
+	default:
+		return 0;
+	}
+}
+
+u64 walk(
+	syntax::ExpressionStore const & store,
+	syntax::NodeId<syntax::Expression> id
+) {
+	auto payload = store.payload(id);
+	switch (store.kind(id)) {
+	case syntax::ExpressionKind::binary:
+		return walk(store, {.offset = payload.first}) +
+			   walk(store, {.offset = payload.second});
+	case syntax::ExpressionKind::int_literal:
+		return store[id].value.int_literal.value;
+	case syntax::ExpressionKind::identifier:
+		return payload.second;
+	default:
+		return 0;
+	}
+}
+
+/// Expressions as a union in a NodeArena against the struct of arrays
+/// of ExpressionStore, in bytes per node and full tree walks
+void bench_ast() {
+	usize node_count = 4 << 20;
+
+	syntax::NodeArena arena;
+	auto roots = generate_trees(node_count, [&](syntax::Expression e) {
+		return arena.push(e);
+	});
+	u64 sum = 0;
+	double seconds = bench::best_of(5, [&] {
+		sum = 0;
+		for (auto root : roots) {
+			sum += walk(arena, root);
+		}
+	});
+	std::println(
+		"ast union: {:.1f} bytes/node, {:.1f} Mnodes/s walked, sum {}",
+		(double)arena.size() / (double)node_count,
+		(double)node_count / seconds / 1e6,
+		sum
+	);
+
+	syntax::ExpressionStore store;
+	roots = generate_trees(node_count, [&](syntax::Expression e) {
+		return store.push(e);
+	});
+	seconds = bench::best_of(5, [&] {
+		sum = 0;
+		for (auto root : roots) {
+			sum += walk(store, root);
+		}
+	});
+	std::println(
+		"ast struct of arrays: {:.1f} bytes/node, {:.1f} Mnodes/s walked, "
+		"sum {}",
+		(double)store.memory() / (double)node_count,
+		(double)node_count / seconds / 1e6,
+		sum
+	);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "bench.cpp"
+#include "driver.cpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <thread>
+
+/// Project mode on a generated directory of small files, by thread
+/// count, to check how close scaling is to linear
+void bench_driver() {
+	namespace fs = std::filesystem;
+	char path[] = "/tmp/peopl_bench_XXXXXX";
+	if (mkdtemp(path) == nullptr) {
+		return;
+	}
+	fs::path root = path;
+
+	usize bytes = 0;
+	for (usize i = 0; i < 2000; ++i) {
+		fs::path directory = root / std::format("module{}", i % 20);
+		fs::create_directories(directory);
+		std::string corpus;
+		bench::generate_program(corpus, 8 << 10, i);
+		std::ofstream(directory / std::format("file{}.ppl", i)) << corpus;
+		bytes += corpus.size();
+	}
+
+	auto paths = *driver::find_sources(root.string());
+	usize cores = std::max(1u, std::thread::hardware_concurrency());
+	double single = 0;
+	for (usize threads = 1; threads <= cores; threads *= 2) {
+		ThreadPool pool(threads);
+		usize token_count = 0;
+		// wall time, the work is spread over threads
+		auto begin = std::chrono::steady_clock::now();
+		for (usize i = 0; i < 3; ++i) {
+			driver::Project project = driver::load_project(paths, pool);
+			token_count = 0;
+			for (auto const & file : project.files) {
+				token_count += file.tokens;
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(end - begin).count() / 3;
+		if (threads == 1) {
+			single = seconds;
+		}
+		std::println(
+			"project: {} files, {} threads, {} tokens, {:.1f} MB/s, "
+			"{:.2f}x",
+			paths.size(),
+			threads,
+			token_count,
+			(double)bytes / seconds / 1e6,
+			single / seconds
+		);
+	}
+
+	fs::remove_all(root);
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include "bench.cpp"
+#include "syntax/literal.cpp"
+#include "syntax/tokenizer.cpp"
+#include <cstdlib>
+#include <print>
+#include <string>
+#include <vector>
+
+/// Numeric heavy source: lines of integer literals in every base, some
+/// with separators
+void generate_numeric_corpus(std::string & corpus, usize size, u64 seed) {
+	bench::Random random = {.state = seed};
+	const char hex[] = "0123456789abcdef";
+	while (corpus.size() < size) {
+		for (usize i = 0; i < 8; ++i) {
+			switch (random.below(8)) {
+			case 0:
+				corpus += "0x";
+				for (usize d = 1 + random.below(16); d > 0; --d) {
+					corpus += hex[random.below(16)];
+				}
+				break;
+			case 1:
+				corpus += "0b";
+				for (usize d = 1 + random.below(32); d > 0; --d) {
+					corpus += (char)('0' + random.below(2));
+				}
+				break;
+			case 2:
+				corpus += "1_000_000_";
+				corpus += std::to_string(random.below(1000));
+				break;
+			case 3:
+				corpus += std::to_string(random.next() * random.next());
+				break;
+			default:
+				corpus += std::to_string(random.below(100000));
+			}
+			corpus += ", ";
+		}
+		corpus += '\n';
+	}
+}
+
+void bench_int_literals() {
+	std::string corpus;
+	generate_numeric_corpus(corpus, 16 << 20, 21);
+	String source((const u8 *)corpus.data(), corpus.size());
+
+	std::vector<std::pair<String, u8>> literals;
+	auto tokenizer = syntax::Tokenizer(source);
+	for (auto token = tokenizer.next_token();
+		 token.kind != syntax::TokenKind::eof;
+		 token = tokenizer.next_token()) {
+		switch (token.kind) {
+		case syntax::TokenKind::int_literal:
+			literals.push_back({token.value, 10});
+			break;
+		case syntax::TokenKind::hex_literal:
+			literals.push_back({token.value, 16});
+			break;
+		case syntax::TokenKind::bin_literal:
+			literals.push_back({token.value, 2});
+			break;
+		default:
+			break;
+		}
+	}
+
+	auto bench = [&](const char * name, auto && convert) {
+		u64 sum = 0;
+		double seconds = bench::best_of(5, [&] {
+			sum = 0;
+			for (auto [literal, base] : literals) {
+				sum += convert(literal, base).value_or(0);
+			}
+		});
+		std::println(
+			"int literals {}: {:.1f} Mliterals/s, sum {}",
+			name,
+			(double)literals.size() / seconds / 1e6,
+			sum
+		);
+	};
+	bench("scalar", syntax::int_from_string_scalar);
+	bench("swar", syntax::int_from_string);
+}
+
+void bench_literal() {
+	bench_int_literals();
+
+	// literals as written in sources: short decimals, exponents, and a
+	// few long ones that need more than 19 digits
+	bench::Random random = {.state = 13};
+	std::string corpus;
+	std::vector<String> literals;
+	std::vector<usize> offsets;
+	for (usize i = 0; i < 1 << 18; ++i) {
+		offsets.push_back(corpus.size());
+		corpus += std::to_string(random.below(100000));
+		corpus += '.';
+		corpus += std::to_string(random.below(1000000));
+		switch (random.below(4)) {
+		case 0:
+			corpus += "e" + std::to_string((isize)random.below(600) - 300);
+			break;
+		case 1:
+			corpus += std::to_string(random.next()) +
+					  std::to_string(random.next());
+			break;
+		}
+		offsets.push_back(corpus.size());
+		// strtod needs a terminator
+		corpus += '\0';
+	}
+	for (usize i = 0; i < offsets.size(); i += 2) {
+		literals.push_back(String(
+			(const u8 *)corpus.data() + offsets[i], offsets[i + 1] - offsets[i]
+		));
+	}
+
+	f64 sum = 0;
+	double seconds = bench::best_of(5, [&] {
+		sum = 0;
+		for (String const & literal : literals) {
+			sum += syntax::float_from_string(literal);
+		}
+	});
+	std::println(
+		"float literals: {:.1f} Mliterals/s, {:.1f} MB/s, sum {}",
+		(double)literals.size() / seconds / 1e6,
+		(double)corpus.size() / seconds / 1e6,
+		sum
+	);
+
+	seconds = bench::best_of(5, [&] {
+		sum = 0;
+		for (String const & literal : literals) {
+			sum += strtod((const char *)literal.data, nullptr);
+		}
+	});
+	std::println(
+		"float literals strtod: {:.1f} Mliterals/s, {:.1f} MB/s, sum {}",
+		(double)literals.size() / seconds / 1e6,
+		(double)corpus.size() / seconds / 1e6,
+		sum
+	);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "bench.cpp"
+#include "syntax/relex.cpp"
+#include <print>
+#include <string>
+
+void bench_relex() {
+	// generated lines average about 60 bytes
+	std::string text;
+	bench::generate_corpus(text, 50000 * 60, 7);
+	String source((const u8 *)text.data(), text.size());
+
+	syntax::TokenStream tokens(source);
+	double full = bench::best_of(5, [&] {
+		tokens = syntax::TokenStream(source);
+		auto tokenizer = syntax::Tokenizer(source);
+		syntax::Token token;
+		do {
+			token = tokenizer.next_token();
+			tokens.push(token);
+		} while (token.kind != syntax::TokenKind::eof);
+	});
+
+	// typing and deleting one character at spread out positions, only
+	// the relex calls are timed
+	bench::Random random = {.state = 11};
+	const usize edits = 2000;
+	double seconds = 0;
+	for (usize i = 0; i < edits; ++i) {
+		usize offset = random.below(text.size());
+		if (i % 2 == 0) {
+			text.insert(offset, 1, 'a');
+		} else {
+			text.erase(offset, 1);
+		}
+		source = String((const u8 *)text.data(), text.size());
+		seconds += bench::best_of(1, [&] {
+			syntax::relex(
+				tokens,
+				source,
+				{.offset = offset, .removed = i % 2, .inserted = 1 - i % 2}
+			);
+		});
+	}
+
+	std::println(
+		"relex: {} bytes, {} tokens, full {:.2f} ms, edit {:.2f} us",
+		text.size(),
+		tokens.size(),
+		full * 1e3,
+		seconds / (double)edits * 1e6
+	);
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include "bench.cpp"
+#include "syntax/literal.cpp"
+#include "syntax/parser.cpp"
+#include "syntax/tokenizer.cpp"
+#include "thread_pool.cpp"
+#include <algorithm>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Front end phases on a generated program, comparable across runs
+/// through their json output
+std::vector<bench::Measurement> bench_suite(std::string const & corpus) {
+	String source((const u8 *)corpus.data(), corpus.size());
+	std::vector<bench::Measurement> measurements;
+
+	measurements.push_back(
+		bench::measure("tokenizer", 5, [&](bench::Measurement & m) {
+			auto tokenizer = syntax::Tokenizer(source);
+			m.bytes = source.size;
+			m.tokens = 0;
+			syntax::Token token;
+			do {
+				token = tokenizer.next_token();
+				m.tokens += 1;
+			} while (token.kind != syntax::TokenKind::eof);
+		})
+	);
+
+	measurements.push_back(
+		bench::measure(
+			"tokenizer_interned",
+			5,
+			[&](bench::Measurement & m) {
+				Interner interner;
+				auto tokenizer = syntax::Tokenizer(source, &interner);
+				m.bytes = source.size;
+				m.tokens = 0;
+				syntax::Token token;
+				do {
+					token = tokenizer.next_token();
+					m.tokens += 1;
+				} while (token.kind != syntax::TokenKind::eof);
+			}
+		)
+	);
+
+	// Parser::Parser lexes the whole source into its token stream
+	measurements.push_back(
+		bench::measure("parser_tokens", 5, [&](bench::Measurement & m) {
+			syntax::Parser parser(source);
+			m.bytes = source.size;
+			m.tokens = parser.get_tokens().size();
+		})
+	);
+
+	measurements.push_back(
+		bench::measure("parser", 5, [&](bench::Measurement & m) {
+			syntax::Parser parser(source);
+			parser.parse();
+			m.bytes = source.size;
+			m.tokens = parser.get_tokens().size();
+			m.nodes = parser.get_nodes().size();
+		})
+	);
+
+	// long flat chains mixing every precedence level
+	std::string chains;
+	bench::generate_operator_chains(chains, corpus.size(), 3, 4096);
+	String chain_source((const u8 *)chains.data(), chains.size());
+	measurements.push_back(
+		bench::measure(
+			"parser_operator_chains",
+			5,
+			[&](bench::Measurement & m) {
+				syntax::Parser parser(chain_source);
+				parser.parse();
+				m.bytes = chain_source.size;
+				m.tokens = parser.get_tokens().size();
+				m.nodes = parser.get_nodes().size();
+			}
+		)
+	);
+
+	// top level definitions parsed on every core, lexing stays serial
+	ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	measurements.push_back(
+		bench::measure("parser_parallel", 5, [&](bench::Measurement & m) {
+			syntax::Parser parser(source);
+			parser.parse(pool);
+			m.bytes = source.size;
+			m.tokens = parser.get_tokens().size();
+			m.nodes = parser.get_nodes().size();
+		})
+	);
+
+	// tokens pulled as the parser moves instead of stored up front
+	measurements.push_back(
+		bench::measure("parser_streaming", 5, [&](bench::Measurement & m) {
+			syntax::StreamingParser parser(source);
+			parser.parse();
+			m.bytes = source.size;
+			m.tokens = parser.get_token_count();
+			m.nodes = parser.get_nodes().size();
+		})
+	);
+
+	measurements.push_back(
+		bench::measure(
+			"parser_explicit_stack",
+			5,
+			[&](bench::Measurement & m) {
+				syntax::Parser parser(source);
+				parser.parse(syntax::ParseMode::explicit_stack);
+				m.bytes = source.size;
+				m.tokens = parser.get_tokens().size();
+				m.nodes = parser.get_nodes().size();
+			}
+		)
+	);
+
+	// a million levels overflow the native stack of the recursive mode
+	std::string nesting;
+	bench::generate_nesting(nesting, 1'000'000, 5);
+	String nesting_source((const u8 *)nesting.data(), nesting.size());
+	measurements.push_back(
+		bench::measure(
+			"parser_deep_nesting",
+			5,
+			[&](bench::Measurement & m) {
+				syntax::Parser parser(nesting_source);
+				parser.parse(syntax::ParseMode::explicit_stack);
+				m.bytes = nesting_source.size;
+				m.tokens = parser.get_tokens().size();
+				m.nodes = parser.get_nodes().size();
+			}
+		)
+	);
+
+	std::vector<syntax::Token> literals;
+	usize literal_bytes = 0;
+	auto tokenizer = syntax::Tokenizer(source);
+	for (auto token = tokenizer.next_token();
+		 token.kind != syntax::TokenKind::eof;
+		 token = tokenizer.next_token()) {
+		switch (token.kind) {
+		case syntax::TokenKind::int_literal:
+		case syntax::TokenKind::hex_literal:
+		case syntax::TokenKind::oct_literal:
+		case syntax::TokenKind::bin_literal:
+			literals.push_back(token);
+			literal_bytes += token.value.size;
+			break;
+		default:
+			break;
+		}
+	}
+	// int_from_token dispatches to int_from_string on the base
+	measurements.push_back(
+		bench::measure("int_from_string", 5, [&](bench::Measurement & m) {
+			u64 sum = 0;
+			for (syntax::Token const & literal : literals) {
+				sum += syntax::int_from_token(literal).value_or(0);
+			}
+			bench::do_not_optimize(sum);
+			m.bytes = literal_bytes;
+			m.tokens = literals.size();
+		})
+	);
+
+	return measurements;
+}
+
+void print_suite(std::vector<bench::Measurement> const & measurements) {
+	for (bench::Measurement const & m : measurements) {
+		std::println(
+			"{}: {:.1f} MB/s, {:.1f} Mtokens/s, {:.1f} Mnodes/s, "
+			"{} KiB peak rss, {} allocations, {} KiB allocated",
+			m.name,
+			bench::per_second(m.bytes, m.seconds) / 1e6,
+			bench::per_second(m.tokens, m.seconds) / 1e6,
+			bench::per_second(m.nodes, m.seconds) / 1e6,
+			m.peak_rss / 1024,
+			m.allocations,
+			m.allocated_bytes / 1024
+		);
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "bench.cpp"
+#include "syntax/line_index.cpp"
+#include "syntax/parallel_tokenizer.cpp"
+#include "syntax/stream_tokenizer.cpp"
+#include "syntax/token_stream.cpp"
+#include "syntax/tokenizer.cpp"
+#include <cstdio>
+#include <print>
+#include <thread>
+#include <vector>
+
+void bench_tokenizer() {
+	std::string corpus;
+	bench::generate_corpus(corpus, 16 << 20, 42);
+	String source((const u8 *)corpus.data(), corpus.size());
+
+	usize token_count = 0;
+	double seconds = bench::best_of(5, [&] {
+		auto tokenizer = syntax::Tokenizer(source);
+		token_count = 0;
+		syntax::Token token;
+		do {
+			token = tokenizer.next_token();
+			token_count += 1;
+		} while (token.kind != syntax::TokenKind::eof);
+	});
+
+	std::println(
+		"tokenizer: {} bytes, {} tokens, {:.1f} MB/s, {:.1f} Mtokens/s",
+		source.size,
+		token_count,
+		(double)source.size / seconds / 1e6,
+		(double)token_count / seconds / 1e6
+	);
+
+	usize symbol_count = 0;
+	seconds = bench::best_of(5, [&] {
+		Interner interner;
+		auto tokenizer = syntax::Tokenizer(source, &interner);
+		syntax::Token token;
+		do {
+			token = tokenizer.next_token();
+		} while (token.kind != syntax::TokenKind::eof);
+		symbol_count = interner.size();
+	});
+	std::println(
+		"tokenizer with interner: {:.1f} MB/s, {} symbols",
+		(double)source.size / seconds / 1e6,
+		symbol_count
+	);
+
+	// both filling a TokenStream, per token and in batches
+	seconds = bench::best_of(5, [&] {
+		auto tokenizer = syntax::Tokenizer(source);
+		syntax::TokenStream stream(source);
+		syntax::Token token;
+		do {
+			token = tokenizer.next_token();
+			stream.push(token);
+		} while (token.kind != syntax::TokenKind::eof);
+	});
+	std::println(
+		"tokenizer into stream: {:.1f} MB/s",
+		(double)source.size / seconds / 1e6
+	);
+
+	seconds = bench::best_of(5, [&] {
+		auto tokenizer = syntax::Tokenizer(source);
+		syntax::TokenStream stream(source);
+		syntax::Token batch[256];
+		usize count;
+		do {
+			count = tokenizer.next_tokens(batch);
+			stream.push(std::span(batch, count));
+		} while (batch[count - 1].kind != syntax::TokenKind::eof);
+	});
+	std::println(
+		"batch tokenizer into stream: {:.1f} MB/s",
+		(double)source.size / seconds / 1e6
+	);
+
+	auto file = SourceFile::from_string(source);
+	seconds = bench::best_of(5, [&] {
+		auto tokenizer = syntax::SentinelTokenizer(file);
+		token_count = 0;
+		syntax::Token token;
+		do {
+			token = tokenizer.next_token();
+			token_count += 1;
+		} while (token.kind != syntax::TokenKind::eof);
+	});
+
+	std::println(
+		"sentinel tokenizer: {:.1f} MB/s, {:.1f} Mtokens/s",
+		(double)source.size / seconds / 1e6,
+		(double)token_count / seconds / 1e6
+	);
+
+	// streamed from a file through the default window
+	FILE * file_stream = tmpfile();
+	fwrite(corpus.data(), 1, corpus.size(), file_stream);
+	fflush(file_stream);
+	usize stream_memory = 0;
+	seconds = bench::best_of(5, [&] {
+		lseek(fileno(file_stream), 0, SEEK_SET);
+		syntax::StreamTokenizer tokenizer(fileno(file_stream));
+		token_count = 0;
+		syntax::Token token;
+		do {
+			token = tokenizer.next_token();
+			token_count += 1;
+		} while (token.kind != syntax::TokenKind::eof);
+		stream_memory = tokenizer.memory();
+	});
+	fclose(file_stream);
+
+	std::println(
+		"stream tokenizer: {} tokens, {:.1f} MB/s, {} bytes window",
+		token_count,
+		(double)source.size / seconds / 1e6,
+		stream_memory
+	);
+
+	auto tokenizer = syntax::Tokenizer(source);
+	syntax::TokenStream stream(source);
+	syntax::Token token;
+	do {
+		token = tokenizer.next_token();
+		stream.push(token);
+	} while (token.kind != syntax::TokenKind::eof);
+
+	std::println(
+		"token storage: std::vector<Token> {} bytes/token, "
+		"TokenStream {:.2f} bytes/token",
+		sizeof(syntax::Token),
+		(double)stream.memory() / (double)stream.size()
+	);
+
+	usize cores = std::max(1u, std::thread::hardware_concurrency());
+	for (usize threads = 1; threads <= cores; threads *= 2) {
+		seconds = bench::best_of(5, [&] {
+			token_count = syntax::tokenize_parallel(source, threads).size();
+		});
+		std::println(
+			"parallel tokenizer: {} threads, {} tokens, {:.1f} MB/s",
+			threads,
+			token_count,
+			(double)source.size / seconds / 1e6
+		);
+	}
+
+	usize line_count = 0;
+	seconds = bench::best_of(5, [&] {
+		syntax::LineIndex index(source);
+		line_count = index.line_count();
+	});
+	std::println(
+		"line index: {} lines, {:.1f} MB/s",
+		line_count,
+		(double)source.size / seconds / 1e6
+	);
+}
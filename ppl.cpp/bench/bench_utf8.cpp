@@ -0,0 +1,56 @@
+#pragma once
+#include "bench.cpp"
+#include "syntax/tokenizer.cpp"
+#include "utf8.cpp"
+#include <print>
+
+void bench_utf8() {
+	std::string corpus;
+	bench::generate_multibyte_corpus(corpus, 16 << 20, 42);
+	String source((const u8 *)corpus.data(), corpus.size());
+
+	usize multibyte = 0;
+	for (usize i = 0; i < source.size; ++i) {
+		multibyte += syntax::is_utf8(source[i]) ? 1 : 0;
+	}
+	std::println(
+		"multibyte corpus: {} bytes, {:.1f}% non ascii",
+		source.size,
+		100.0 * (double)multibyte / (double)source.size
+	);
+
+	usize valid_until = 0;
+	double seconds = bench::best_of(5, [&] {
+		valid_until = utf8::validate_scalar(source.data, 0, source.size);
+	});
+	std::println(
+		"utf8 validation scalar: {:.1f} MB/s, valid: {}",
+		(double)source.size / seconds / 1e6,
+		valid_until == source.size
+	);
+	seconds = bench::best_of(5, [&] {
+		valid_until = utf8::validate(source.data, 0, source.size);
+	});
+	std::println(
+		"utf8 validation: {:.1f} MB/s, valid: {}",
+		(double)source.size / seconds / 1e6,
+		valid_until == source.size
+	);
+
+	usize token_count = 0;
+	seconds = bench::best_of(5, [&] {
+		auto tokenizer = syntax::Tokenizer(source);
+		token_count = 0;
+		syntax::Token token;
+		do {
+			token = tokenizer.next_token();
+			token_count += 1;
+		} while (token.kind != syntax::TokenKind::eof);
+	});
+	std::println(
+		"tokenizer multibyte: {} tokens, {:.1f} MB/s, {:.1f} Mtokens/s",
+		token_count,
+		(double)source.size / seconds / 1e6,
+		(double)token_count / seconds / 1e6
+	);
+}
@@ -1,9 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <optional>
 #include <print>
 #include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <utility>
+#include <vector>
 
 typedef uint8_t u8;
 typedef int8_t i8;
@@ -13,8 +23,11 @@ typedef uint32_t u32;
 typedef int32_t i32;
 typedef uint64_t u64;
 typedef int64_t i64;
+typedef float f32;
+typedef double f64;
 
 typedef size_t usize;
+typedef ptrdiff_t isize;
 
 struct String {
 	const u8 * data;
@@ -46,6 +59,147 @@ struct String {
 	}
 };
 
+/// Contents of a source file followed by at least PADDING zero bytes,
+/// so scanners can read ahead of the end without bounds checks.
+/// Regular files are memory mapped, pipes and stdin are read into a
+/// heap buffer.
+struct SourceFile {
+	static constexpr usize PADDING = 64;
+
+  private:
+	u8 * data = nullptr;
+	usize size = 0;
+	/// Bytes of the mapping, 0 when `data` is a heap buffer
+	usize mapped = 0;
+
+	SourceFile() {}
+
+	/// Maps `size` bytes of the regular file `fd`. An anonymous zero
+	/// mapping covering the padding is reserved first, the file is then
+	/// mapped over its start. The kernel zero fills the last file page
+	/// past the end, the pages after it stay anonymous zeros.
+	static std::optional<SourceFile> map(int fd, usize size) {
+		usize page = (usize)sysconf(_SC_PAGESIZE);
+		usize length = (size + PADDING + page - 1) / page * page;
+
+		void * reserved = mmap(
+			nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+		);
+		if (reserved == MAP_FAILED) {
+			return std::nullopt;
+		}
+		void * file = mmap(
+			reserved, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0
+		);
+		if (file == MAP_FAILED) {
+			int error = errno;
+			munmap(reserved, length);
+			errno = error;
+			return std::nullopt;
+		}
+		madvise(file, size, MADV_SEQUENTIAL);
+
+		SourceFile source;
+		source.data = (u8 *)file;
+		source.size = size;
+		source.mapped = length;
+		return source;
+	}
+
+	/// Reads `fd` until end of file into a growing heap buffer
+	static std::optional<SourceFile> read_all(int fd) {
+		SourceFile source;
+		usize capacity = 64 << 10;
+		source.data = (u8 *)malloc(capacity + PADDING);
+
+		while (true) {
+			if (source.size == capacity) {
+				capacity *= 2;
+				source.data = (u8 *)realloc(source.data, capacity + PADDING);
+			}
+			ssize_t count =
+				read(fd, source.data + source.size, capacity - source.size);
+			if (count == 0) {
+				break;
+			}
+			if (count < 0) {
+				int error = errno;
+				free(source.data);
+				source.data = nullptr;
+				errno = error;
+				return std::nullopt;
+			}
+			source.size += (usize)count;
+		}
+		memset(source.data + source.size, 0, PADDING);
+		return source;
+	}
+
+  public:
+	~SourceFile() {
+		if (mapped != 0) {
+			munmap(data, mapped);
+		} else {
+			free(data);
+		}
+	}
+
+	SourceFile(const SourceFile &) = delete;
+	SourceFile(SourceFile && o)
+		: data(o.data), size(o.size), mapped(o.mapped) {
+		o.data = nullptr;
+		o.mapped = 0;
+	}
+
+	SourceFile & operator=(const SourceFile &) = delete;
+	SourceFile & operator=(SourceFile && o) {
+		std::swap(data, o.data);
+		std::swap(size, o.size);
+		std::swap(mapped, o.mapped);
+		return *this;
+	}
+
+	/// Loads the file at `path`, "-" reads stdin. On failure errno is
+	/// the one of the call that failed.
+	static std::optional<SourceFile> open(const char * path) {
+		if (strcmp(path, "-") == 0) {
+			return read_all(STDIN_FILENO);
+		}
+
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			return std::nullopt;
+		}
+		struct stat status;
+		std::optional<SourceFile> source;
+		if (fstat(fd, &status) == 0) {
+			if (S_ISREG(status.st_mode) and status.st_size > 0) {
+				source = map(fd, (usize)status.st_size);
+			} else {
+				source = read_all(fd);
+			}
+		}
+		// closing must not hide why the load failed
+		int error = errno;
+		close(fd);
+		errno = error;
+		return source;
+	}
+
+	/// Copies `string` into a padded buffer
+	static SourceFile from_string(String string) {
+		SourceFile source;
+		source.data = (u8 *)malloc(string.size + PADDING);
+		source.size = string.size;
+		memcpy(source.data, string.data, string.size);
+		memset(source.data + string.size, 0, PADDING);
+		return source;
+	}
+
+	/// Contents without the padding
+	String string() const { return String(data, size); }
+};
+
 template <typename T> struct Array {
   private:
 	T * data = nullptr;
@@ -103,3 +257,171 @@ template <typename T> struct Array {
 		}
 	}
 };
+
+/// Bump allocator for data living as long as the arena. Memory comes
+/// from blocks that never move and is freed all at once.
+struct Arena {
+	static constexpr usize BLOCK = 64 << 10;
+
+  private:
+	std::vector<u8 *> blocks;
+	u8 * cursor = nullptr;
+	usize available = 0;
+	usize reserved = 0;
+
+  public:
+	Arena() {}
+
+	~Arena() {
+		for (u8 * block : blocks) {
+			free(block);
+		}
+	}
+
+	Arena(const Arena &) = delete;
+	Arena & operator=(const Arena &) = delete;
+
+	Arena(Arena && other)
+		: blocks(std::move(other.blocks)),
+		  cursor(std::exchange(other.cursor, nullptr)),
+		  available(std::exchange(other.available, 0)),
+		  reserved(std::exchange(other.reserved, 0)) {}
+
+	Arena & operator=(Arena && other) {
+		std::swap(blocks, other.blocks);
+		std::swap(cursor, other.cursor);
+		std::swap(available, other.available);
+		std::swap(reserved, other.reserved);
+		return *this;
+	}
+
+	/// `size` bytes aligned to `align`, a power of two
+	u8 * allocate(usize size, usize align = 1) {
+		usize padding = -(uintptr_t)cursor & (align - 1);
+		if (padding + size > available) {
+			// the rest of the current block is dropped
+			usize block_size = std::max(BLOCK, size + align);
+			u8 * block = (u8 *)malloc(block_size);
+			blocks.push_back(block);
+			reserved += block_size;
+			cursor = block;
+			available = block_size;
+			padding = -(uintptr_t)cursor & (align - 1);
+		}
+		u8 * result = cursor + padding;
+		cursor = result + size;
+		available -= padding + size;
+		return result;
+	}
+
+	/// Copy of `string` owned by the arena
+	String copy(String string) {
+		u8 * data = allocate(string.size);
+		memcpy(data, string.data, string.size);
+		return String(data, string.size);
+	}
+
+	/// Bytes reserved from the system
+	usize memory() const { return reserved; }
+};
+
+/// Hash of the bytes of `string`, eight bytes per step
+u64 hash_string(String string) {
+	u64 hash = string.size * 0x9E3779B97F4A7C15ull;
+	usize i = 0;
+	for (; i + 8 <= string.size; i += 8) {
+		u64 word;
+		memcpy(&word, string.data + i, sizeof(word));
+		hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+		hash ^= hash >> 31;
+	}
+	if (i < string.size) {
+		u64 word = 0;
+		memcpy(&word, string.data + i, string.size - i);
+		hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+	}
+	hash ^= hash >> 29;
+	hash *= 0x94D049BB133111EBull;
+	return hash ^ (hash >> 32);
+}
+
+/// Maps strings to dense u32 symbols, equal strings get the same
+/// symbol. Symbols are handed out in first interned order from 0, their
+/// strings are copied into an arena and stay valid as long as the
+/// interner. Comparing or hashing two symbols is an integer operation.
+///
+/// The table is open addressed with linear probing and kept at most
+/// half full. Each slot holds the hash of its string next to the
+/// symbol, probes only compare bytes when the hashes match.
+struct Interner {
+	static constexpr u32 NO_SYMBOL = ~0u;
+
+  private:
+	struct Slot {
+		u32 hash;
+		u32 symbol;
+	};
+
+	Arena arena;
+	std::vector<String> strings;
+	std::vector<u32> hashes;
+	/// Power of two size
+	std::vector<Slot> slots;
+
+	void grow() {
+		std::vector<Slot> grown(
+			std::max<usize>(64, slots.size() * 2),
+			Slot{.hash = 0, .symbol = NO_SYMBOL}
+		);
+		usize mask = grown.size() - 1;
+		for (u32 symbol = 0; symbol < strings.size(); ++symbol) {
+			usize i = hashes[symbol] & mask;
+			while (grown[i].symbol != NO_SYMBOL) {
+				i = (i + 1) & mask;
+			}
+			grown[i] = {.hash = hashes[symbol], .symbol = symbol};
+		}
+		slots = std::move(grown);
+	}
+
+  public:
+	Interner() {}
+
+	Interner(const Interner &) = delete;
+	Interner & operator=(const Interner &) = delete;
+	Interner(Interner &&) = default;
+	Interner & operator=(Interner &&) = default;
+
+	/// Symbol of `string`, new ones copy it into the arena
+	u32 intern(String string) {
+		if (2 * (strings.size() + 1) > slots.size()) {
+			grow();
+		}
+		u32 hash = (u32)hash_string(string);
+		usize mask = slots.size() - 1;
+		usize i = hash & mask;
+		while (slots[i].symbol != NO_SYMBOL) {
+			if (slots[i].hash == hash and strings[slots[i].symbol] == string) {
+				return slots[i].symbol;
+			}
+			i = (i + 1) & mask;
+		}
+
+		u32 symbol = (u32)strings.size();
+		strings.push_back(arena.copy(string));
+		hashes.push_back(hash);
+		slots[i] = {.hash = hash, .symbol = symbol};
+		return symbol;
+	}
+
+	String operator[](u32 symbol) const { return strings[symbol]; }
+
+	usize size() const { return strings.size(); }
+
+	/// Bytes held by the interner
+	usize memory() const {
+		return arena.memory() + strings.capacity() * sizeof(String) +
+			   hashes.capacity() * sizeof(u32) +
+			   slots.capacity() * sizeof(Slot);
+	}
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include "common.cpp"
+#include "syntax/line_index.cpp"
+#include "syntax/parser.cpp"
+#include "thread_pool.cpp"
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/// Project mode: every .ppl file under a directory goes through the
+/// front end on a fixed pool of threads.
+namespace driver {
+
+/// Paths of the .ppl files under `directory`, sorted so results do not
+/// depend on the directory order. Empty if `directory` can not be
+/// read.
+std::optional<std::vector<std::string>>
+find_sources(std::string const & directory) {
+	namespace fs = std::filesystem;
+	std::error_code error;
+	auto entry = fs::recursive_directory_iterator(
+		directory, fs::directory_options::skip_permission_denied, error
+	);
+	if (error) {
+		return std::nullopt;
+	}
+
+	std::vector<std::string> paths;
+	for (; entry != fs::recursive_directory_iterator();
+		 entry.increment(error)) {
+		if (error) {
+			return std::nullopt;
+		}
+		if (entry->is_regular_file(error) and
+			entry->path().extension() == ".ppl") {
+			paths.push_back(entry->path().string());
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+/// Front end result of one file
+struct FileResult {
+	std::string path;
+	/// Whether the file could be read and is at most
+	/// LineIndex::MAX_SOURCE_SIZE bytes, nothing else is set otherwise
+	bool loaded = false;
+	usize bytes = 0;
+	usize tokens = 0;
+	usize nodes = 0;
+	std::vector<syntax::LexicalError> lexical_errors;
+	std::vector<syntax::SyntaxError> syntax_errors;
+	/// Line and column of each lexical error, then of each syntax error
+	std::vector<syntax::Point> error_points;
+	/// Project symbol of every symbol of the file
+	std::vector<u32> symbols;
+};
+
+struct Project {
+	/// In path order
+	std::vector<FileResult> files;
+	/// Identifiers of all files, numbered in path order
+	Interner interner;
+};
+
+/// Runs the files in `paths` through the front end on `pool`.
+///
+/// Each worker copies the identifiers of its files into its own arena,
+/// so files share no allocator state while they are processed. They
+/// are merged into the project interner in path order afterwards,
+/// results are the same whatever the thread count and scheduling.
+Project load_project(std::vector<std::string> paths, ThreadPool & pool) {
+	Project project;
+	project.files.resize(paths.size());
+	std::vector<Arena> arenas(pool.size());
+	std::vector<std::vector<String>> names(paths.size());
+
+	pool.for_each(paths.size(), [&](usize worker, usize index) {
+		FileResult & file = project.files[index];
+		file.path = std::move(paths[index]);
+		auto source = SourceFile::open(file.path.c_str());
+		if (not source or
+			source->string().size > syntax::LineIndex::MAX_SOURCE_SIZE) {
+			return;
+		}
+		file.loaded = true;
+		file.bytes = source->string().size;
+
+		// tokens are not kept, and generated files can nest deeper than
+		// the native stack allows
+		syntax::StreamingParser parser(source->string());
+		parser.parse(syntax::ParseMode::explicit_stack);
+		file.tokens = parser.get_token_count();
+		file.nodes = parser.get_nodes().size();
+		auto lexical_errors = parser.get_lexical_errors();
+		file.lexical_errors.assign(
+			lexical_errors.begin(), lexical_errors.end()
+		);
+		file.syntax_errors = parser.get_errors();
+
+		// lines are only scanned for files with errors to point at
+		if (not file.lexical_errors.empty() or
+			not file.syntax_errors.empty()) {
+			syntax::LineIndex lines(source->string());
+			for (syntax::LexicalError const & error : file.lexical_errors) {
+				file.error_points.push_back(lines.resolve(error.offset));
+			}
+			for (syntax::SyntaxError const & error : file.syntax_errors) {
+				file.error_points.push_back(lines.resolve(error.offset));
+			}
+		}
+
+		Interner const & interner = parser.get_interner();
+		names[index].reserve(interner.size());
+		for (u32 symbol = 0; symbol < interner.size(); ++symbol) {
+			names[index].push_back(arenas[worker].copy(interner[symbol]));
+		}
+	});
+
+	for (usize index = 0; index < paths.size(); ++index) {
+		std::vector<u32> & symbols = project.files[index].symbols;
+		symbols.reserve(names[index].size());
+		for (String name : names[index]) {
+			symbols.push_back(project.interner.intern(name));
+		}
+	}
+	return project;
+}
+
+}; // namespace driver
@@ -1,16 +1,153 @@
 #include "peopl.cpp"
+#include <cerrno>
+#include <filesystem>
 #include <print>
+#include <thread>
 
-int main() {
-	char const * string = "comp   if (  i+ 234) /  siz   , fn .| |hi "
-						  "@a|\n x: fn() -> {}";
+/// `line:column` of a point, both counted from 1 like editors do
+std::string position(syntax::Point point) {
+	return std::format("{}:{}", point.line + 1, point.column + 1);
+}
+
+/// Position of `offset`, the byte offset itself past the lines a
+/// LineIndex can hold, which only a stream reaches
+std::string position(syntax::LineIndex const & lines, usize offset) {
+	if (offset >= syntax::LineIndex::MAX_SOURCE_SIZE) {
+		return std::format("byte {}", offset);
+	}
+	return position(lines.resolve(offset));
+}
 
-	auto tokenizer = syntax::Tokenizer(string);
+/// Prints the tokens, then the lexical errors to stderr, returns
+/// whether there were none. New lines the tokenizer passes are added
+/// to `lines`, so a streamed source is indexed as it is read.
+template <typename T>
+bool print_tokens(T & tokenizer, syntax::LineIndex & lines) {
 	syntax::Token token;
 	do {
 		token = tokenizer.next_token();
-		std::println("token {}", token);
+		if (token.kind == syntax::TokenKind::new_line and
+			token.start < syntax::LineIndex::MAX_SOURCE_SIZE) {
+			lines.add_new_line(token.start);
+		}
+		std::println("{} token {}", position(lines, token.start), token);
 	} while (token.kind != syntax::TokenKind::eof);
 
-	return 0;
+	for (syntax::LexicalError const & error : tokenizer.errors()) {
+		std::println(
+			stderr, "{} error {}", position(lines, error.offset), error
+		);
+	}
+	return tokenizer.errors().empty();
+}
+
+/// Runs every .ppl file under `directory` through the front end and
+/// prints a line per file, then its errors to stderr
+int run_project(const char * directory, usize threads) {
+	auto paths = driver::find_sources(directory);
+	if (not paths) {
+		std::println(stderr, "could not read {}", directory);
+		return 1;
+	}
+
+	ThreadPool pool(threads);
+	driver::Project project = driver::load_project(std::move(*paths), pool);
+
+	bool valid = true;
+	usize bytes = 0;
+	usize tokens = 0;
+	usize nodes = 0;
+	for (driver::FileResult const & file : project.files) {
+		if (not file.loaded) {
+			std::println(
+				stderr, "could not read {} or it is too large", file.path
+			);
+			valid = false;
+			continue;
+		}
+		std::println(
+			"{}: {} bytes, {} tokens, {} nodes",
+			file.path,
+			file.bytes,
+			file.tokens,
+			file.nodes
+		);
+		// error_points holds the lexical errors' points, then the
+		// syntax errors'
+		usize point = 0;
+		for (syntax::LexicalError const & error : file.lexical_errors) {
+			std::println(
+				stderr,
+				"{}:{}: error {}",
+				file.path,
+				position(file.error_points[point++]),
+				error
+			);
+		}
+		for (syntax::SyntaxError const & error : file.syntax_errors) {
+			std::println(
+				stderr,
+				"{}:{}: error {}",
+				file.path,
+				position(file.error_points[point++]),
+				error
+			);
+		}
+		valid = valid and file.lexical_errors.empty() and
+				file.syntax_errors.empty();
+		bytes += file.bytes;
+		tokens += file.tokens;
+		nodes += file.nodes;
+	}
+	std::println(
+		"{} files, {} bytes, {} tokens, {} nodes, {} symbols",
+		project.files.size(),
+		bytes,
+		tokens,
+		nodes,
+		project.interner.size()
+	);
+	return valid ? 0 : 1;
+}
+
+int main(int argc, char ** argv) {
+	if (argc != 2 and argc != 3) {
+		std::println(
+			stderr, "usage: {} <file.ppl | - | directory [threads]>", argv[0]
+		);
+		return 1;
+	}
+
+	if (std::filesystem::is_directory(argv[1])) {
+		usize threads = argc == 3 ? strtoull(argv[2], nullptr, 10)
+								  : std::thread::hardware_concurrency();
+		return run_project(argv[1], std::max<usize>(1, threads));
+	}
+	if (argc == 3) {
+		std::println(stderr, "{} is not a directory", argv[1]);
+		return 1;
+	}
+
+	// stdin is streamed, it can be larger than memory
+	if (strcmp(argv[1], "-") == 0) {
+		syntax::StreamTokenizer tokenizer(STDIN_FILENO);
+		syntax::LineIndex lines;
+		bool valid = print_tokens(tokenizer, lines);
+		return valid and not tokenizer.failed() ? 0 : 1;
+	}
+
+	auto source = SourceFile::open(argv[1]);
+	if (not source) {
+		std::println(stderr, "could not read {}: {}", argv[1], strerror(errno));
+		return 1;
+	}
+
+	if (source->string().size > syntax::LineIndex::MAX_SOURCE_SIZE) {
+		std::println(stderr, "{} is too large", argv[1]);
+		return 1;
+	}
+
+	syntax::LineIndex lines(source->string());
+	auto tokenizer = syntax::SentinelTokenizer(*source);
+	return print_tokens(tokenizer, lines) ? 0 : 1;
 }
@@ -1,2 +1,8 @@
+#include "driver.cpp"
+#include "syntax/literal.cpp"
+#include "syntax/parallel_tokenizer.cpp"
 #include "syntax/parser.cpp"
+#include "syntax/parser+debug.cpp"
+#include "syntax/relex.cpp"
+#include "syntax/stream_tokenizer.cpp"
 #include "syntax/tokenizer+debug.cpp"
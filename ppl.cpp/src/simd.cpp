@@ -0,0 +1,210 @@
+#pragma once
+#include "common.cpp"
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PEOPL_SIMD_X86 1
+#endif
+
+/// Byte scanning kernels for the tokenizer hot loops.
+///
+/// Every skip / find kernel scans `data[from, size)` and returns the
+/// index of the first byte that stops the scan, or `size` if none
+/// does. Kernels never read past `size`, the vector loops hand the
+/// tail over to the scalar versions.
+namespace simd {
+
+bool is_blank(u32 rune) {
+	return rune == ' ' or rune == '\t' or rune == '\r';
+}
+
+/// Bytes that end a line comment or a multi line string body. Sources
+/// are validated as UTF-8 up front, so multibyte runes are skipped as
+/// plain bytes, neither a new line nor 0 occurs inside them.
+bool is_line_stop(u8 c) { return c == '\n' or c == 0; }
+
+usize skip_blanks_scalar(const u8 * data, usize from, usize size) {
+	while (from < size and is_blank(data[from])) {
+		from += 1;
+	}
+	return from;
+}
+
+usize find_line_stop_scalar(const u8 * data, usize from, usize size) {
+	while (from < size and not is_line_stop(data[from])) {
+		from += 1;
+	}
+	return from;
+}
+
+/// Appends the offset following every new line in `data[from, size)`
+void line_starts_scalar(
+	const u8 * data, usize from, usize size, std::vector<u32> & starts
+) {
+	for (; from < size; ++from) {
+		if (data[from] == '\n') {
+			starts.push_back((u32)(from + 1));
+		}
+	}
+}
+
+#ifdef PEOPL_SIMD_X86
+
+usize skip_blanks_sse2(const u8 * data, usize from, usize size) {
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i carriage = _mm_set1_epi8('\r');
+
+	for (; from + 16 <= size; from += 16) {
+		__m128i chunk =
+			_mm_loadu_si128((const __m128i *)(data + from));
+		__m128i blank = _mm_or_si128(
+			_mm_or_si128(
+				_mm_cmpeq_epi8(chunk, space),
+				_mm_cmpeq_epi8(chunk, tab)
+			),
+			_mm_cmpeq_epi8(chunk, carriage)
+		);
+		u32 stops = ~(u32)_mm_movemask_epi8(blank) & 0xFFFF;
+		if (stops != 0) {
+			return from + (usize)__builtin_ctz(stops);
+		}
+	}
+	return skip_blanks_scalar(data, from, size);
+}
+
+usize find_line_stop_sse2(const u8 * data, usize from, usize size) {
+	const __m128i new_line = _mm_set1_epi8('\n');
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; from + 16 <= size; from += 16) {
+		__m128i chunk =
+			_mm_loadu_si128((const __m128i *)(data + from));
+		u32 stops = (u32)_mm_movemask_epi8(_mm_or_si128(
+			_mm_cmpeq_epi8(chunk, new_line), _mm_cmpeq_epi8(chunk, zero)
+		));
+		if (stops != 0) {
+			return from + (usize)__builtin_ctz(stops);
+		}
+	}
+	return find_line_stop_scalar(data, from, size);
+}
+
+void line_starts_sse2(
+	const u8 * data, usize from, usize size, std::vector<u32> & starts
+) {
+	const __m128i new_line = _mm_set1_epi8('\n');
+
+	for (; from + 16 <= size; from += 16) {
+		__m128i chunk =
+			_mm_loadu_si128((const __m128i *)(data + from));
+		u32 lines = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, new_line));
+		while (lines != 0) {
+			starts.push_back((u32)(from + (usize)__builtin_ctz(lines) + 1));
+			lines &= lines - 1;
+		}
+	}
+	line_starts_scalar(data, from, size, starts);
+}
+
+__attribute__((target("avx2"))) usize
+skip_blanks_avx2(const u8 * data, usize from, usize size) {
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i carriage = _mm256_set1_epi8('\r');
+
+	for (; from + 32 <= size; from += 32) {
+		__m256i chunk =
+			_mm256_loadu_si256((const __m256i *)(data + from));
+		__m256i blank = _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_cmpeq_epi8(chunk, space),
+				_mm256_cmpeq_epi8(chunk, tab)
+			),
+			_mm256_cmpeq_epi8(chunk, carriage)
+		);
+		u32 stops = ~(u32)_mm256_movemask_epi8(blank);
+		if (stops != 0) {
+			return from + (usize)__builtin_ctz(stops);
+		}
+	}
+	return skip_blanks_sse2(data, from, size);
+}
+
+__attribute__((target("avx2"))) usize
+find_line_stop_avx2(const u8 * data, usize from, usize size) {
+	const __m256i new_line = _mm256_set1_epi8('\n');
+	const __m256i zero = _mm256_setzero_si256();
+
+	for (; from + 32 <= size; from += 32) {
+		__m256i chunk =
+			_mm256_loadu_si256((const __m256i *)(data + from));
+		u32 stops = (u32)_mm256_movemask_epi8(_mm256_or_si256(
+			_mm256_cmpeq_epi8(chunk, new_line),
+			_mm256_cmpeq_epi8(chunk, zero)
+		));
+		if (stops != 0) {
+			return from + (usize)__builtin_ctz(stops);
+		}
+	}
+	return find_line_stop_sse2(data, from, size);
+}
+
+__attribute__((target("avx2"))) void line_starts_avx2(
+	const u8 * data, usize from, usize size, std::vector<u32> & starts
+) {
+	const __m256i new_line = _mm256_set1_epi8('\n');
+
+	for (; from + 32 <= size; from += 32) {
+		__m256i chunk =
+			_mm256_loadu_si256((const __m256i *)(data + from));
+		u32 lines =
+			(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, new_line));
+		while (lines != 0) {
+			starts.push_back((u32)(from + (usize)__builtin_ctz(lines) + 1));
+			lines &= lines - 1;
+		}
+	}
+	line_starts_sse2(data, from, size, starts);
+}
+
+#endif
+
+/// Set of kernels picked once at startup for the running cpu
+struct Kernels {
+	usize (*skip_blanks)(const u8 * data, usize from, usize size);
+	usize (*find_line_stop)(const u8 * data, usize from, usize size);
+	void (*line_starts)(
+		const u8 * data, usize from, usize size, std::vector<u32> & starts
+	);
+};
+
+Kernels select_kernels() {
+#ifdef PEOPL_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return {
+			.skip_blanks = skip_blanks_avx2,
+			.find_line_stop = find_line_stop_avx2,
+			.line_starts = line_starts_avx2
+		};
+	}
+	// sse2 is part of the x86-64 baseline
+	return {
+		.skip_blanks = skip_blanks_sse2,
+		.find_line_stop = find_line_stop_sse2,
+		.line_starts = line_starts_sse2
+	};
+#else
+	return {
+		.skip_blanks = skip_blanks_scalar,
+		.find_line_stop = find_line_stop_scalar,
+		.line_starts = line_starts_scalar
+	};
+#endif
+}
+
+const Kernels KERNELS = select_kernels();
+
+}; // namespace simd
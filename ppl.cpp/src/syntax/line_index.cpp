@@ -0,0 +1,59 @@
+#pragma once
+#include "../common.cpp"
+#include "../simd.cpp"
+#include <algorithm>
+#include <vector>
+
+namespace syntax {
+
+/// Line and column in original source, columns count bytes
+struct Point {
+	usize line;
+	usize column;
+
+	bool operator==(const Point &) const = default;
+	auto operator<=>(const Point &) const = default;
+};
+
+/// Start offset of every line of a source, built in one vectorized
+/// scan for new lines. Resolves byte offsets to points only when a
+/// position is actually needed, e.g. for diagnostics.
+///
+/// Line starts are stored in 32 bits, sources must not be larger than
+/// MAX_SOURCE_SIZE.
+struct LineIndex {
+	static constexpr usize MAX_SOURCE_SIZE = ~(u32)0;
+
+  private:
+	std::vector<u32> line_starts = {0};
+
+  public:
+	/// Index of a source read piece by piece, see add_new_line
+	LineIndex() {}
+
+	LineIndex(String source) {
+		simd::KERNELS.line_starts(source.data, 0, source.size, line_starts);
+	}
+
+	/// Records the new line at `offset`, for sources indexed as they
+	/// are read. New lines must come in source order, the ones already
+	/// indexed are ignored.
+	void add_new_line(usize offset) {
+		if (offset >= line_starts.back()) {
+			line_starts.push_back((u32)(offset + 1));
+		}
+	}
+
+	usize line_count() const { return line_starts.size(); }
+
+	/// Line and column of a byte offset
+	Point resolve(usize offset) const {
+		auto line_end = std::upper_bound(
+			line_starts.begin(), line_starts.end(), offset
+		);
+		usize line = (usize)(line_end - line_starts.begin()) - 1;
+		return {.line = line, .column = offset - line_starts[line]};
+	}
+};
+
+}; // namespace syntax
@@ -0,0 +1,663 @@
+#pragma once
+#include "../common.cpp"
+#include "../utf8.cpp"
+#include "literal+tables.cpp"
+#include <algorithm>
+#include <iterator>
+#include <optional>
+
+namespace syntax {
+
+/// Value of digit `c` in bases up to 16, `c` must be a digit
+u8 int_from_char(u8 c) {
+	// '0'-'9' have bit 6 clear, 'a'-'f' and 'A'-'F' have it set and
+	// their low nibble counts from 1
+	return (c & 0x0F) + (c >> 6) * 9;
+}
+
+/// Offset of the first digit of an integer literal in `base`, after
+/// its 0x, 0o or 0b prefix
+usize int_digits_start(u8 base) { return base == 10 ? 0 : 2; }
+
+/// Value of an integer literal as produced by the tokenizer, a base
+/// prefix, digits of `base` and '_' separators. Empty if it does not
+/// fit in u64 or has no digits. One digit at a time, the reference for
+/// `int_from_string`.
+std::optional<u64> int_from_string_scalar(String const & content, u8 base) {
+	u64 value = 0;
+	bool has_digits = false;
+	for (usize i = int_digits_start(base); i < content.size; ++i) {
+		if (content[i] == '_') {
+			continue;
+		}
+		if (__builtin_mul_overflow(value, (u64)base, &value) or
+			__builtin_add_overflow(value, int_from_char(content[i]), &value)) {
+			return std::nullopt;
+		}
+		has_digits = true;
+	}
+	if (not has_digits) {
+		return std::nullopt;
+	}
+	return value;
+}
+
+/// Value of the 8 digits of `base` in `word`, first digit in the lowest
+/// byte. Each step merges neighbouring lanes: d0 * base + d1 in 16 bit
+/// lanes, then 32 bit lanes with base^2, then the whole word with
+/// base^4. No lane overflows for bases up to 16.
+u64 int_from_word(u64 word, u64 base) {
+	u64 digits = (word & 0x0F0F0F0F0F0F0F0Full) +
+				 ((word >> 6) & 0x0101010101010101ull) * 9;
+	digits = (digits * base + (digits >> 8)) & 0x00FF00FF00FF00FFull;
+	digits =
+		(digits * (base * base) + (digits >> 16)) & 0x0000FFFF0000FFFFull;
+	u64 base_4 = base * base * base * base;
+	return (digits * base_4 + (digits >> 32)) & 0xFFFFFFFFull;
+}
+
+/// Whether any byte of `word` is '_'
+bool has_separator(u64 word) {
+	u64 x = word ^ 0x5F5F5F5F5F5F5F5Full;
+	return ((x - 0x0101010101010101ull) & ~x & 0x8080808080808080ull) != 0;
+}
+
+/// base^8 for the four literal bases
+u64 int_power_8(u8 base) {
+	switch (base) {
+	case 10:
+		return 100000000;
+	case 16:
+		return 1ull << 32;
+	case 8:
+		return 1ull << 24;
+	default:
+		return 1ull << 8;
+	}
+}
+
+/// Same as `int_from_string_scalar`, eight digits per step. Digits are
+/// loaded as whole words with the first count % 8 of them moved to the
+/// top of the first word, the zero bytes below them count as leading
+/// zeros. Literals shorter than a word or with separators take the
+/// scalar path.
+std::optional<u64> int_from_string(String const & content, u8 base) {
+	usize start = int_digits_start(base);
+	if (content.size <= start) {
+		return std::nullopt;
+	}
+	usize count = content.size - start;
+	usize first = count % 8 == 0 ? 8 : count % 8;
+
+	u64 word = 0;
+	if (count > 8) {
+		memcpy(&word, content.data + start, sizeof(word));
+		word <<= 8 * (8 - first);
+	} else if (content.size >= 8) {
+		// the digits end the literal, drop the bytes before them
+		memcpy(&word, content.data + content.size - 8, sizeof(word));
+		word &= ~0ull << 8 * (8 - first);
+	} else {
+		// too short to load a word, one multiply per digit is as fast
+		return int_from_string_scalar(content, base);
+	}
+	if (has_separator(word)) {
+		return int_from_string_scalar(content, base);
+	}
+	// eight digits fit in 32 bits for every base
+	u64 value = int_from_word(word, base);
+
+	u64 power = int_power_8(base);
+	for (usize i = start + first; i < content.size; i += 8) {
+		memcpy(&word, content.data + i, sizeof(word));
+		if (has_separator(word)) {
+			return int_from_string_scalar(content, base);
+		}
+		if (__builtin_mul_overflow(value, power, &value) or
+			__builtin_add_overflow(value, int_from_word(word, base), &value)) {
+			return std::nullopt;
+		}
+	}
+	return value;
+}
+
+/// Rune of the `\u{...}` escape whose hex digits start at `body[i]`,
+/// `i` is moved past the closing brace. Empty unless 1 to 6 digits
+/// name a scalar value.
+std::optional<u32> unicode_escape(String const & body, usize & i) {
+	u32 rune = 0;
+	usize digits = 0;
+	for (; i < body.size and body[i] != '}'; ++i) {
+		u8 c = body[i];
+		bool hex = (c >= '0' and c <= '9') or (c >= 'a' and c <= 'f') or
+				   (c >= 'A' and c <= 'F');
+		if (not hex or digits == 6) {
+			return std::nullopt;
+		}
+		rune = rune << 4 | int_from_char(c);
+		digits += 1;
+	}
+	if (i == body.size or digits == 0 or rune > 0x10FFFF or
+		(rune >= 0xD800 and rune <= 0xDFFF)) {
+		return std::nullopt;
+	}
+	i += 1;
+	return rune;
+}
+
+/// Contents of a string literal token. Escapes in `"..."` literals
+/// are decoded into `arena`, literals without any are returned as a
+/// slice of the source. `"""` literals are raw. Empty if an escape is
+/// unknown or malformed.
+///
+/// Escapes: \n \t \r \0 \\ \" \' and \u{1F680} with 1 to 6 hex
+/// digits.
+std::optional<String> unescape_string(String const & literal, Arena & arena) {
+	if (literal.size >= 3 and literal[1] == '"' and literal[2] == '"') {
+		return literal.substring(3, literal.size);
+	}
+	String body = literal.substring(1, literal.size - 1);
+	const void * escape = memchr(body.data, '\\', body.size);
+	if (escape == nullptr) {
+		return body;
+	}
+
+	// escapes never decode to more bytes than they are written with
+	u8 * decoded = arena.allocate(body.size);
+	usize start = (usize)((const u8 *)escape - body.data);
+	memcpy(decoded, body.data, start);
+	usize size = start;
+	for (usize i = start; i < body.size;) {
+		u8 c = body[i];
+		if (c != '\\') {
+			decoded[size] = c;
+			size += 1;
+			i += 1;
+			continue;
+		}
+		if (i + 1 == body.size) {
+			return std::nullopt;
+		}
+		u8 escaped = body[i + 1];
+		i += 2;
+		switch (escaped) {
+		case 'n':
+			decoded[size++] = '\n';
+			break;
+		case 't':
+			decoded[size++] = '\t';
+			break;
+		case 'r':
+			decoded[size++] = '\r';
+			break;
+		case '0':
+			decoded[size++] = 0;
+			break;
+		case '\\':
+		case '"':
+		case '\'':
+			decoded[size++] = escaped;
+			break;
+		case 'u': {
+			if (i == body.size or body[i] != '{') {
+				return std::nullopt;
+			}
+			i += 1;
+			std::optional<u32> rune = unicode_escape(body, i);
+			if (not rune) {
+				return std::nullopt;
+			}
+			size += utf8::encode(*rune, decoded + size);
+			break;
+		}
+		default:
+			return std::nullopt;
+		}
+	}
+	return String(decoded, size);
+}
+
+/// Decimal to binary64 conversion of float literals, correctly
+/// rounded, without strtod or the locale.
+///
+/// Literals with at most 19 significant digits are converted with the
+/// Eisel-Lemire algorithm: the digits as a 64 bit integer w times a
+/// 128 bit approximation of 5^q (see "Number Parsing at a Gigabyte per
+/// Second", Lemire). Longer literals are bracketed between w and w + 1
+/// and only fall back to an exact big decimal when the two disagree.
+
+/// Binary64 value as biased exponent and explicit mantissa bits
+struct BinaryFloat {
+	u64 mantissa;
+	i32 power2;
+
+	bool operator==(const BinaryFloat &) const = default;
+
+	f64 to_f64() const {
+		u64 bits = mantissa | (u64)power2 << MANTISSA_BITS;
+		f64 value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	static constexpr i32 MANTISSA_BITS = 52;
+	static constexpr i32 MINIMUM_EXPONENT = -1023;
+	static constexpr i32 INFINITE_POWER = 0x7FF;
+};
+
+/// Float literal split into w * 10^q, `truncated` when nonzero digits
+/// past the first 19 significant ones were dropped from w
+struct DecimalLiteral {
+	u64 w = 0;
+	i64 q = 0;
+	bool truncated = false;
+};
+
+/// Exponents past this are clamped, they over or underflow anyway
+constexpr i64 MAX_DECIMAL_EXPONENT = 1 << 20;
+
+/// Parses the digits, '_' separators, '.' and exponent of a float
+/// literal, an imaginary suffix must be stripped first
+DecimalLiteral parse_decimal_literal(String const & content) {
+	DecimalLiteral decimal;
+	usize digits = 0;
+	usize i = 0;
+	bool fraction = false;
+
+	for (; i < content.size; ++i) {
+		u8 c = content[i];
+		if (c == '_') {
+			continue;
+		}
+		if (c == '.') {
+			fraction = true;
+			continue;
+		}
+		if (c < '0' or c > '9') {
+			break;
+		}
+		u8 digit = c - '0';
+		if (digits == 0 and digit == 0) {
+			// leading zeros are not significant
+			decimal.q -= fraction ? 1 : 0;
+		} else if (digits < 19) {
+			decimal.w = decimal.w * 10 + digit;
+			digits += 1;
+			decimal.q -= fraction ? 1 : 0;
+		} else {
+			decimal.q += fraction ? 0 : 1;
+			decimal.truncated |= digit != 0;
+		}
+	}
+
+	if (i < content.size) {
+		// exponent
+		i += 1;
+		bool negative = false;
+		if (i < content.size and (content[i] == '+' or content[i] == '-')) {
+			negative = content[i] == '-';
+			i += 1;
+		}
+		i64 exponent = 0;
+		for (; i < content.size; ++i) {
+			if (content[i] != '_' and exponent < MAX_DECIMAL_EXPONENT) {
+				exponent = exponent * 10 + (content[i] - '0');
+			}
+		}
+		decimal.q += negative ? -exponent : exponent;
+	}
+	return decimal;
+}
+
+/// Eisel-Lemire, w * 10^q rounded to nearest even. Exact for any w,
+/// the 128 bit product is always precise enough (Mushtak, Lemire,
+/// "Fast Number Parsing Without Fallback").
+BinaryFloat eisel_lemire(i64 q, u64 w) {
+	constexpr i32 mantissa_bits = BinaryFloat::MANTISSA_BITS;
+
+	if (w == 0 or q < SMALLEST_POWER_OF_FIVE) {
+		return {.mantissa = 0, .power2 = 0};
+	}
+	if (q > LARGEST_POWER_OF_FIVE) {
+		return {.mantissa = 0, .power2 = BinaryFloat::INFINITE_POWER};
+	}
+
+	i32 leading_zeros = __builtin_clzll(w);
+	w <<= leading_zeros;
+
+	// only the high word of the product matters, its bits below the
+	// mantissa, one rounding bit and a possible normalization shift
+	// are all ones when the low word could still carry into it
+	const u64 * power = POWERS_OF_FIVE[q - SMALLEST_POWER_OF_FIVE];
+	unsigned __int128 first = (unsigned __int128)w * power[0];
+	u64 high = (u64)(first >> 64);
+	u64 low = (u64)first;
+	constexpr u64 precision_mask = ~0ull >> (mantissa_bits + 3);
+	if ((high & precision_mask) == precision_mask) {
+		u64 second = (u64)(((unsigned __int128)w * power[1]) >> 64);
+		low += second;
+		high += low < second ? 1 : 0;
+	}
+
+	i32 upper_bit = (i32)(high >> 63);
+	i32 shift = upper_bit + 64 - mantissa_bits - 3;
+	BinaryFloat result;
+	result.mantissa = high >> shift;
+	// floor(log2(10^q)) + 63 is ((152170 + 65536) * q >> 16) + 63
+	result.power2 = (i32)((((152170 + 65536) * q) >> 16) + 63) + upper_bit -
+					leading_zeros - BinaryFloat::MINIMUM_EXPONENT;
+
+	if (result.power2 <= 0) {
+		// subnormal, or zero when everything is shifted out
+		if (-result.power2 + 1 >= 64) {
+			return {.mantissa = 0, .power2 = 0};
+		}
+		result.mantissa >>= -result.power2 + 1;
+		result.mantissa += result.mantissa & 1;
+		result.mantissa >>= 1;
+		// rounding may carry into the smallest normal
+		result.power2 =
+			result.mantissa < (1ull << mantissa_bits) ? 0 : 1;
+		return result;
+	}
+
+	// exactly halfway between two floats only happens when 5^q fits a
+	// word, and then the dropped bits are all zeros: round to even
+	if (low <= 1 and q >= -4 and q <= 23 and (result.mantissa & 3) == 1 and
+		result.mantissa << shift == high) {
+		result.mantissa &= ~1ull;
+	}
+
+	result.mantissa += result.mantissa & 1;
+	result.mantissa >>= 1;
+	if (result.mantissa >= 2ull << mantissa_bits) {
+		result.mantissa = 1ull << mantissa_bits;
+		result.power2 += 1;
+	}
+	result.mantissa &= ~(1ull << mantissa_bits);
+
+	if (result.power2 >= BinaryFloat::INFINITE_POWER) {
+		return {.mantissa = 0, .power2 = BinaryFloat::INFINITE_POWER};
+	}
+	return result;
+}
+
+/// Exact decimal 0.d1d2d3... * 10^point, the slow path for literals
+/// whose first 19 digits don't decide the rounding. Shifted by powers
+/// of two until it lies in [1/2, 1), then rounded (the "simple decimal
+/// conversion" of Wuffs, Nigel Tao).
+struct BigDecimal {
+	static constexpr usize MAX_DIGITS = 800;
+	static constexpr i32 POINT_RANGE = 2047;
+	/// Largest shift that keeps digit << shift plus carries in 64 bits
+	static constexpr u32 MAX_SHIFT = 60;
+
+	u8 digits[MAX_DIGITS];
+	usize count = 0;
+	i32 point = 0;
+	/// Nonzero digits past MAX_DIGITS were dropped
+	bool truncated = false;
+
+	explicit BigDecimal(String const & content) {
+		usize i = 0;
+		bool fraction = false;
+		for (; i < content.size; ++i) {
+			u8 c = content[i];
+			if (c == '_') {
+				continue;
+			}
+			if (c == '.') {
+				fraction = true;
+				continue;
+			}
+			if (c < '0' or c > '9') {
+				break;
+			}
+			if (count == 0 and c == '0') {
+				point -= fraction ? 1 : 0;
+				continue;
+			}
+			push(c - '0');
+			point += fraction ? 0 : 1;
+		}
+
+		DecimalLiteral exponent =
+			parse_decimal_literal(content.substring(i, content.size));
+		i64 shifted = point + exponent.q;
+		point = (i32)std::clamp<i64>(shifted, -100000, 100000);
+		trim();
+	}
+
+	void push(u8 digit) {
+		if (count < MAX_DIGITS) {
+			digits[count] = digit;
+			count += 1;
+		} else if (digit != 0) {
+			truncated = true;
+		}
+	}
+
+	void trim() {
+		while (count > 0 and digits[count - 1] == 0) {
+			count -= 1;
+		}
+	}
+
+	/// Divides by 2^shift
+	void right_shift(u32 shift) {
+		usize read = 0;
+		usize write = 0;
+		u64 n = 0;
+		// enough leading digits to produce a first nonzero digit
+		while ((n >> shift) == 0) {
+			if (read < count) {
+				n = 10 * n + digits[read];
+				read += 1;
+			} else if (n == 0) {
+				return;
+			} else {
+				while ((n >> shift) == 0) {
+					n *= 10;
+					read += 1;
+				}
+				break;
+			}
+		}
+
+		point -= (i32)read - 1;
+		if (point < -POINT_RANGE) {
+			count = 0;
+			point = 0;
+			truncated = false;
+			return;
+		}
+
+		u64 mask = (1ull << shift) - 1;
+		while (read < count) {
+			u8 digit = (u8)(n >> shift);
+			n = 10 * (n & mask) + digits[read];
+			read += 1;
+			digits[write] = digit;
+			write += 1;
+		}
+		while (n > 0) {
+			u8 digit = (u8)(n >> shift);
+			n = 10 * (n & mask);
+			if (write < MAX_DIGITS) {
+				digits[write] = digit;
+				write += 1;
+			} else if (digit > 0) {
+				truncated = true;
+			}
+		}
+		count = write;
+		trim();
+	}
+
+	/// Multiplies by 2^shift, from the last digit up
+	void left_shift(u32 shift) {
+		if (count == 0) {
+			return;
+		}
+		// at most 19 digits are added, 2^60 < 10^19
+		u8 reversed[MAX_DIGITS + 19];
+		usize written = 0;
+		u64 carry = 0;
+		for (usize i = count; i > 0; --i) {
+			u64 n = ((u64)digits[i - 1] << shift) + carry;
+			reversed[written] = (u8)(n % 10);
+			written += 1;
+			carry = n / 10;
+		}
+		while (carry > 0) {
+			reversed[written] = (u8)(carry % 10);
+			written += 1;
+			carry /= 10;
+		}
+
+		point += (i32)(written - count);
+		count = 0;
+		for (usize i = written; i > 0; --i) {
+			push(reversed[i - 1]);
+		}
+		trim();
+	}
+
+	/// Integer part rounded to nearest even
+	u64 round() const {
+		if (count == 0 or point < 0) {
+			return 0;
+		}
+		if (point > 18) {
+			return ~0ull;
+		}
+		usize integer = (usize)point;
+		u64 n = 0;
+		for (usize i = 0; i < integer; ++i) {
+			n = 10 * n + (i < count ? digits[i] : 0);
+		}
+		bool round_up = false;
+		if (integer < count) {
+			round_up = digits[integer] >= 5;
+			if (digits[integer] == 5 and integer + 1 == count) {
+				// halfway unless digits were dropped
+				round_up = truncated or
+						   (integer > 0 and (digits[integer - 1] & 1));
+			}
+		}
+		return n + (round_up ? 1 : 0);
+	}
+
+	BinaryFloat to_binary() {
+		constexpr BinaryFloat zero = {.mantissa = 0, .power2 = 0};
+		constexpr BinaryFloat infinity = {
+			.mantissa = 0, .power2 = BinaryFloat::INFINITE_POWER
+		};
+		// shifts whose decimal digit count change by the index
+		constexpr u8 shifts[] = {0,	 3,	 6,	 9,	 13, 16, 19, 23, 26, 29,
+								 33, 36, 39, 43, 46, 49, 53, 56, 59};
+		constexpr i32 minimum_exponent = BinaryFloat::MINIMUM_EXPONENT;
+		constexpr i32 mantissa_bits = BinaryFloat::MANTISSA_BITS;
+
+		if (count == 0 or point < -324) {
+			return zero;
+		}
+		if (point >= 310) {
+			return infinity;
+		}
+
+		i32 exponent = 0;
+		while (point > 0) {
+			u32 n = (u32)point;
+			u32 shift = n < std::size(shifts) ? shifts[n] : MAX_SHIFT;
+			right_shift(shift);
+			if (point < -POINT_RANGE) {
+				return zero;
+			}
+			exponent += (i32)shift;
+		}
+		// towards [1/2, 1)
+		while (point <= 0) {
+			u32 shift;
+			if (point == 0) {
+				if (digits[0] >= 5) {
+					break;
+				}
+				shift = digits[0] < 2 ? 2 : 1;
+			} else {
+				u32 n = (u32)-point;
+				shift = n < std::size(shifts) ? shifts[n] : MAX_SHIFT;
+			}
+			left_shift(shift);
+			if (point > POINT_RANGE) {
+				return infinity;
+			}
+			exponent -= (i32)shift;
+		}
+		// binary64 mantissas are in [1, 2)
+		exponent -= 1;
+
+		while (minimum_exponent + 1 > exponent) {
+			u32 n = (u32)(minimum_exponent + 1 - exponent);
+			n = std::min(n, MAX_SHIFT);
+			right_shift(n);
+			exponent += (i32)n;
+		}
+		if (exponent - minimum_exponent >= BinaryFloat::INFINITE_POWER) {
+			return infinity;
+		}
+
+		left_shift(mantissa_bits + 1);
+		u64 mantissa = round();
+		if (mantissa >= 1ull << (mantissa_bits + 1)) {
+			// rounding overflowed
+			right_shift(1);
+			exponent += 1;
+			mantissa = round();
+			if (exponent - minimum_exponent >= BinaryFloat::INFINITE_POWER) {
+				return infinity;
+			}
+		}
+
+		BinaryFloat result;
+		result.power2 = exponent - minimum_exponent;
+		if (mantissa < 1ull << mantissa_bits) {
+			// subnormal
+			result.power2 -= 1;
+		}
+		result.mantissa = mantissa & ((1ull << mantissa_bits) - 1);
+		return result;
+	}
+};
+
+/// Value of a float or imaginary literal, rounded to nearest even
+f64 float_from_string(String content) {
+	if (content.size > 0 and content[content.size - 1] == 'i') {
+		content.size -= 1;
+	}
+	DecimalLiteral decimal = parse_decimal_literal(content);
+
+	// w and 10^q both exact doubles, a single rounding (Clinger)
+	constexpr f64 exact_powers[] = {
+		1e0,  1e1,	1e2,  1e3,	1e4,  1e5,	1e6,  1e7,
+		1e8,  1e9,	1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	if (not decimal.truncated and decimal.w <= 1ull << 53 and
+		decimal.q >= -22 and decimal.q <= 22) {
+		f64 value = (f64)decimal.w;
+		return decimal.q < 0 ? value / exact_powers[-decimal.q]
+							 : value * exact_powers[decimal.q];
+	}
+
+	BinaryFloat result = eisel_lemire(decimal.q, decimal.w);
+	if (decimal.truncated and
+		result != eisel_lemire(decimal.q, decimal.w + 1)) {
+		// rare, only when the digits past the 19th decide the rounding
+		BigDecimal exact(content);
+		result = exact.to_binary();
+	}
+	return result.to_f64();
+}
+
+}; // namespace syntax
@@ -0,0 +1,162 @@
+#pragma once
+#include "common.cpp"
+#include <span>
+#include <type_traits>
+
+namespace syntax {
+
+/// Typed handle to a T in a NodeArena, a 32 bit byte offset into it.
+/// Handles stay valid as the arena grows, nodes never move.
+template <typename T> struct NodeId {
+	static constexpr u32 NONE = ~0u;
+
+	u32 offset = NONE;
+
+	bool valid() const { return offset != NONE; }
+
+	bool operator==(NodeId const &) const = default;
+};
+
+/// Handle to `size` contiguous T in a NodeArena
+template <typename T> struct NodeList {
+	u32 offset = 0;
+	u32 size = 0;
+};
+
+/// Bump allocator for syntax nodes. The whole address range nodes can
+/// take is reserved up front and made accessible as the cursor moves,
+/// so nodes are addressed by 32 bit offsets from a single base, never
+/// move, and are freed together by one munmap.
+///
+/// Only trivially copyable and destructible types go in, nothing is
+/// destroyed node by node.
+struct NodeArena {
+	/// Address space reserved per arena, the range of a u32 offset
+	static constexpr usize RESERVED = (usize)1 << 32;
+	/// Pages are made accessible this many bytes at a time
+	static constexpr usize COMMIT = 1 << 20;
+
+  private:
+	u8 * base = nullptr;
+	usize cursor = 0;
+	usize committed = 0;
+
+	/// Makes the range up to `end` accessible
+	void commit(usize end) {
+		usize target = (end + COMMIT - 1) / COMMIT * COMMIT;
+		if (target > RESERVED or
+			mprotect(
+				base + committed,
+				target - committed,
+				PROT_READ | PROT_WRITE
+			) != 0) {
+			// out of node space or memory, nothing sensible is left to do
+			std::abort();
+		}
+		committed = target;
+	}
+
+	/// Offset of `size` bytes aligned to `align`, a power of two
+	u32 allocate(usize size, usize align) {
+		usize offset = (cursor + align - 1) & ~(align - 1);
+		if (offset + size > committed) [[unlikely]] {
+			commit(offset + size);
+		}
+		cursor = offset + size;
+		return (u32)offset;
+	}
+
+  public:
+	NodeArena() {
+		// PROT_NONE costs address space only, not memory
+		void * reserved = mmap(
+			nullptr,
+			RESERVED,
+			PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			-1,
+			0
+		);
+		if (reserved == MAP_FAILED) {
+			std::abort();
+		}
+		base = (u8 *)reserved;
+	}
+
+	~NodeArena() {
+		if (base != nullptr) {
+			munmap(base, RESERVED);
+		}
+	}
+
+	NodeArena(const NodeArena &) = delete;
+	NodeArena & operator=(const NodeArena &) = delete;
+
+	NodeArena(NodeArena && other)
+		: base(std::exchange(other.base, nullptr)),
+		  cursor(std::exchange(other.cursor, 0)),
+		  committed(std::exchange(other.committed, 0)) {}
+
+	NodeArena & operator=(NodeArena && other) {
+		std::swap(base, other.base);
+		std::swap(cursor, other.cursor);
+		std::swap(committed, other.committed);
+		return *this;
+	}
+
+	template <typename T> NodeId<T> push(T const & node) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		u32 offset = allocate(sizeof(T), alignof(T));
+		memcpy(base + offset, &node, sizeof(T));
+		return {.offset = offset};
+	}
+
+	/// Copies `nodes` next to each other
+	template <typename T> NodeList<T> push(std::span<const T> nodes) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		u32 offset = allocate(nodes.size_bytes(), alignof(T));
+		if (not nodes.empty()) {
+			memcpy(base + offset, nodes.data(), nodes.size_bytes());
+		}
+		return {.offset = offset, .size = (u32)nodes.size()};
+	}
+
+	/// Copies `bytes` at an offset aligned to `align`, a power of two,
+	/// for nodes of mixed types copied from another arena
+	u32 push_bytes(std::span<const u8> bytes, usize align) {
+		u32 offset = allocate(bytes.size(), align);
+		if (not bytes.empty()) {
+			memcpy(base + offset, bytes.data(), bytes.size());
+		}
+		return offset;
+	}
+
+	template <typename T> T const & operator[](NodeId<T> id) const {
+		return *(T const *)(base + id.offset);
+	}
+
+	template <typename T> T & operator[](NodeId<T> id) {
+		return *(T *)(base + id.offset);
+	}
+
+	template <typename T>
+	std::span<const T> operator[](NodeList<T> list) const {
+		return {(T const *)(base + list.offset), list.size};
+	}
+
+	template <typename T> std::span<T> operator[](NodeList<T> list) {
+		return {(T *)(base + list.offset), list.size};
+	}
+
+	/// Drops every node at once, the accessible pages are kept for
+	/// reuse
+	void clear() { cursor = 0; }
+
+	/// Bytes taken by nodes
+	usize size() const { return cursor; }
+
+	/// Bytes made accessible, the memory the arena can hold on to
+	usize memory() const { return committed; }
+};
+
+}; // namespace syntax
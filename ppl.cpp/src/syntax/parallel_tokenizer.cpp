@@ -0,0 +1,119 @@
+#pragma once
+#include "token_stream.cpp"
+#include "tokenizer.cpp"
+#include <thread>
+#include <vector>
+
+namespace syntax {
+
+/// Sources smaller than this per thread are not worth splitting
+constexpr usize MIN_CHUNK = 64 << 10;
+
+/// Tokenizes `source` on up to `threads` threads.
+///
+/// No lexical state survives a new line: strings and comments end
+/// before it and a multi line string body is a single line. Every
+/// chunk therefore starts right after a new line, the tokenizer state
+/// at a split is the initial one and no speculation is needed. Chunk
+/// streams are then concatenated with the eof of each chunk but the
+/// last dropped.
+///
+/// With an `interner` every chunk interns into its own one, they are
+/// merged into `interner` in source order afterwards. Symbols come out
+/// the same as with a single tokenizer.
+TokenStream tokenize_parallel(
+	String source, usize threads, Interner * interner = nullptr
+) {
+	usize chunk_count =
+		std::max<usize>(1, std::min(threads, source.size / MIN_CHUNK));
+
+	// split points, each right after the first new line at or past an
+	// even share of the source
+	std::vector<usize> splits = {0};
+	for (usize i = 1; i < chunk_count; ++i) {
+		usize target = std::max(splits.back(), source.size * i / chunk_count);
+		const void * new_line = memchr(
+			source.data + target, '\n', source.size - target
+		);
+		if (new_line == nullptr) {
+			break;
+		}
+		usize split = (usize)((const u8 *)new_line - source.data) + 1;
+		if (split > splits.back()) {
+			splits.push_back(split);
+		}
+	}
+	splits.push_back(source.size);
+	chunk_count = splits.size() - 1;
+
+	struct Chunk {
+		TokenStream tokens;
+		Interner interner;
+	};
+	std::vector<Chunk> chunks;
+	for (usize i = 0; i < chunk_count; ++i) {
+		chunks.push_back(Chunk{.tokens = TokenStream(source)});
+	}
+
+	auto tokenize_chunk = [&](usize i) {
+		usize base = splits[i];
+		auto tokenizer = Tokenizer(
+			source.substring(base, splits[i + 1]),
+			interner != nullptr ? &chunks[i].interner : nullptr
+		);
+		Token batch[256];
+		usize count;
+		do {
+			count = tokenizer.next_tokens(batch);
+			for (usize j = 0; j < count; ++j) {
+				batch[j].start += base;
+				batch[j].end += base;
+			}
+			chunks[i].tokens.push(std::span(batch, count));
+		} while (batch[count - 1].kind != TokenKind::eof);
+
+		std::vector<LexicalError> errors = tokenizer.errors();
+		for (LexicalError & error : errors) {
+			error.offset += base;
+		}
+		chunks[i].tokens.push_errors(errors);
+	};
+
+	std::vector<std::thread> workers;
+	for (usize i = 1; i < chunk_count; ++i) {
+		workers.emplace_back(tokenize_chunk, i);
+	}
+	tokenize_chunk(0);
+	for (auto & worker : workers) {
+		worker.join();
+	}
+
+	if (interner != nullptr) {
+		std::vector<u32> remap;
+		for (Chunk & chunk : chunks) {
+			remap.resize(chunk.interner.size());
+			for (u32 symbol = 0; symbol < chunk.interner.size(); ++symbol) {
+				remap[symbol] = interner->intern(chunk.interner[symbol]);
+			}
+			chunk.tokens.remap_symbols(remap);
+		}
+	}
+
+	if (chunk_count == 1) {
+		return std::move(chunks[0].tokens);
+	}
+
+	usize total = 0;
+	for (Chunk const & chunk : chunks) {
+		total += chunk.tokens.size() - 1;
+	}
+	TokenStream tokens(source);
+	tokens.reserve(total + 1);
+	for (usize i = 0; i < chunk_count; ++i) {
+		usize count = chunks[i].tokens.size() - (i + 1 == chunk_count ? 0 : 1);
+		tokens.append(chunks[i].tokens, count);
+	}
+	return tokens;
+}
+
+}; // namespace syntax
@@ -1,4 +1,124 @@
 #pragma once
 #include "parser.cpp"
+#include "tokenizer+debug.cpp"
 #include <format>
+#include <string>
 
+namespace syntax {
+
+/// Expression `id` as an s-expression, operators by token kind and
+/// leaves by their source text: `(plus a (times 2 b))`
+template <typename Tokens>
+std::string
+format_tree(BasicParser<Tokens> const & parser, NodeId<Expression> id) {
+	if (not id.valid()) {
+		return "<none>";
+	}
+	auto text = [&](usize offset) {
+		String value = parser.get_text(offset);
+		return std::string((const char *)value.data, value.size);
+	};
+
+	Expression expression = parser.get_expression(id);
+	ExpressionValue const & value = expression.value;
+	switch (expression.kind) {
+	case ExpressionKind::int_literal:
+		return text(value.int_literal.offset);
+	case ExpressionKind::float_literal:
+	case ExpressionKind::imaginary_literal:
+		return text(value.float_literal.offset);
+	case ExpressionKind::string_literal:
+		return text(value.string_literal.offset);
+	case ExpressionKind::identifier:
+		return text(value.identifier.offset);
+	case ExpressionKind::tagged:
+		if (not value.tagged.expr.valid()) {
+			return std::format(
+				"(tagged {})", text(value.tagged.tag.offset)
+			);
+		}
+		return std::format(
+			"(tagged {} {})",
+			text(value.tagged.tag.offset),
+			format_tree(parser, value.tagged.expr)
+		);
+	case ExpressionKind::unary:
+		return std::format(
+			"({} {})", value.unary.op, format_tree(parser, value.unary.operand)
+		);
+	case ExpressionKind::binary:
+		return std::format(
+			"({} {} {})",
+			value.binary.op,
+			format_tree(parser, value.binary.lhs),
+			format_tree(parser, value.binary.rhs)
+		);
+	case ExpressionKind::accessed:
+		return std::format(
+			"(access {} {})",
+			format_tree(parser, value.accessed.prefix),
+			text(value.accessed.field.offset)
+		);
+	case ExpressionKind::call: {
+		std::string call =
+			std::format("(call {}", format_tree(parser, value.call.callee));
+		for (NodeId<Expression> argument :
+			 parser.get_expressions(value.call.arguments)) {
+			call += ' ';
+			call += format_tree(parser, argument);
+		}
+		return call + ')';
+	}
+	case ExpressionKind::nothing:
+		return "nothing";
+	case ExpressionKind::invalid:
+		break;
+	}
+	return "<invalid>";
+}
+
+}; // namespace syntax
+
+template <> struct std::formatter<syntax::ErrorCode> {
+	constexpr auto parse(std::format_parse_context & ctx) {
+		return ctx.begin();
+	}
+
+	auto format(const syntax::ErrorCode & code, std::format_context & ctx)
+		const {
+		string_view name;
+		switch (code) {
+		case syntax::ErrorCode::invalid_int_literal:
+			name = "invalid_int_literal";
+			break;
+		case syntax::ErrorCode::expected_expression:
+			name = "expected_expression";
+			break;
+		case syntax::ErrorCode::expected_identifier:
+			name = "expected_identifier";
+			break;
+		case syntax::ErrorCode::unclosed_parenthesis:
+			name = "unclosed_parenthesis";
+			break;
+		case syntax::ErrorCode::unexpected_token:
+			name = "unexpected_token";
+			break;
+		}
+
+		return std::format_to(ctx.out(), "{}", name);
+	}
+};
+
+template <> struct std::formatter<syntax::SyntaxError> {
+	constexpr auto parse(std::format_parse_context & ctx) {
+		return ctx.begin();
+	}
+
+	auto format(
+		const syntax::SyntaxError & error, std::format_context & ctx
+	) const {
+		return std::format_to(
+			ctx.out(), "({}, offset: {})", error.error_code, error.offset
+		);
+	}
+};
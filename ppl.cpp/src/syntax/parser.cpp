@@ -1,46 +1,24 @@
 #pragma once
+#include "../thread_pool.cpp"
+#include "literal.cpp"
+#include "node_arena.cpp"
+#include "token_source.cpp"
+#include "token_stream.cpp"
 #include "tokenizer+debug.cpp"
 #include "tokenizer.cpp"
+#include <array>
+#include <concepts>
 #include <format>
-#include <memory>
-#include <ostream>
+#include <initializer_list>
+#include <optional>
 #include <print>
 #include <vector>
-#include <iostream>
 
 namespace syntax {
 
-u8 int_from_char(u8 c) {
-	if (c >= '0' and c <= '9')
-		return c - '0';
-	if (c >= 'a' and c <= 'f')
-		return 10 + c - 'a';
-	if (c >= 'A' and c <= 'F')
-		return 10 + c - 'A';
-	// FIXME: this should be unreachable
-	return 0;
-}
-
-u64 int_from_string(String const & content, u8 base) {
-	u64 value = 0;
-	usize i = 0;
-	if (base != 10)
-		i = 2;
-
-	std::println("content {} {}", content, content.size);
-	for (; i < content.size; ++i) {
-		if (content[i] == '_') {
-			continue;
-		}
-		// FIXME: prevent overflow
-		value = base * value + int_from_char(content[i]);
-	}
-	std::println("value {}", value);
-	std::cout.flush();
-	return value;
-}
-
-u64 int_from_token(Token const & token) {
+/// Value of an integer literal token, empty if it does not fit in u64
+/// or has no digits
+std::optional<u64> int_from_token(Token const & token) {
 	switch (token.kind) {
 	case TokenKind::int_literal:
 		return int_from_string(token.value, 10);
@@ -52,55 +30,73 @@ u64 int_from_token(Token const & token) {
 		return int_from_string(token.value, 2);
 	default:
 		// unreachable
-		return 0;
+		return std::nullopt;
 	}
 }
 
-i8 get_token_precedence(TokenKind kind) {
-	switch (kind) {
-	case TokenKind::dot:
-		return 12;
-	case TokenKind::lparen:
-		return 11;
-	case TokenKind::exponent:
-		return 10;
-	case TokenKind::times:
-	case TokenKind::by:
-	case TokenKind::mod:
-		return 9;
-	case TokenKind::plus:
-	case TokenKind::minus:
-		return 8;
-	case TokenKind::lshift:
-	case TokenKind::rshift:
-		return 7;
-	case TokenKind::band:
-		return 6;
-	case TokenKind::bxor:
-		return 5;
-	case TokenKind::bor:
-		return 4;
-	case TokenKind::eq:
-	case TokenKind::ge:
-	case TokenKind::gt:
-	case TokenKind::le:
-	case TokenKind::lt:
-		return 3;
-	case TokenKind::kword_and:
-		return 2;
-	case TokenKind::kword_or:
-		return 1;
-	default: // the token is not an operator
-		return -1;
+/// How tightly an infix operator holds its operands, see
+/// INFIX_POWERS. Operators bind left to right: the right power is one
+/// more than the left, so an equal operator to the right stops the
+/// operand and the chain folds to the left.
+struct BindingPower {
+	/// 0 for tokens that are not infix operators
+	u8 left;
+	u8 right;
+};
+
+constexpr usize TOKEN_KIND_COUNT = (usize)TokenKind::invalid + 1;
+
+/// Binding powers of the infix operators, loosest first. Pipes take
+/// whole expressions as operands, comparisons take arithmetics.
+constexpr std::array<BindingPower, TOKEN_KIND_COUNT> INFIX_POWERS = [] {
+	std::array<BindingPower, TOKEN_KIND_COUNT> table = {};
+	const std::initializer_list<TokenKind> levels[] = {
+		{TokenKind::pipe},
+		{TokenKind::kword_or},
+		{TokenKind::kword_and},
+		{TokenKind::eq,
+		 TokenKind::ge,
+		 TokenKind::gt,
+		 TokenKind::le,
+		 TokenKind::lt},
+		{TokenKind::bor},
+		{TokenKind::bxor},
+		{TokenKind::band},
+		{TokenKind::lshift, TokenKind::rshift},
+		{TokenKind::plus, TokenKind::minus},
+		{TokenKind::times, TokenKind::by, TokenKind::mod},
+		{TokenKind::exponent},
+	};
+	u8 power = 2;
+	for (auto const & level : levels) {
+		for (TokenKind kind : level) {
+			table[(usize)kind] = {.left = power, .right = (u8)(power + 1)};
+		}
+		power += 2;
 	}
+	return table;
+}();
+
+/// Operand power of prefix operators, tighter than any infix one:
+/// -a ^ b is (-a) ^ b
+constexpr u8 PREFIX_POWER = 24;
+
+constexpr bool is_prefix_operator(TokenKind kind) {
+	return kind == TokenKind::plus or kind == TokenKind::minus or
+		   kind == TokenKind::bnot or kind == TokenKind::kword_not;
 }
 
 enum class ExpressionKind {
 	int_literal,
+	float_literal,
+	imaginary_literal,
+	string_literal,
 	identifier,
 	tagged,
+	unary,
 	binary,
 	accessed,
+	call,
 	nothing,
 	invalid
 };
@@ -110,36 +106,74 @@ struct Expression;
 struct Nothing {};
 struct Invalid {};
 
+// Leaves refer to their token by its byte offset in the source, see
+// BasicParser::get_text
+
 struct IntLiteral {
 	usize value;
-	usize token_idx;
+	usize offset;
+};
+
+/// Float literal, or the imaginary part of an imaginary literal
+struct FloatLiteral {
+	f64 value;
+	usize offset;
+};
+
+/// String literal, its contents are only decoded when requested with
+/// BasicParser::get_string
+struct StringLiteral {
+	usize offset;
 };
 
 struct Identifier {
-	usize token_idx;
+	usize offset;
+	/// Interned name, see BasicParser::get_interner
+	u32 symbol;
 };
 
 struct Tagged {
 	Identifier tag;
-	usize expr_idx;
+	NodeId<Expression> expr;
+};
+
+struct Unary {
+	TokenKind op;
+	NodeId<Expression> operand;
 };
 
 struct Accessed {
-	usize prefix_expr_idx;
+	NodeId<Expression> prefix;
 	Identifier field;
 };
 
 struct Binary {
 	TokenKind op;
-	usize lhs_expr_idx;
-	usize rhs_expr_idx;
+	NodeId<Expression> lhs;
+	NodeId<Expression> rhs;
+};
+
+/// Expressions of a list, next to each other in the extra data of an
+/// ExpressionStore, see Parser::get_expressions
+struct ExpressionList {
+	NodeList<NodeId<Expression>> expressions;
+};
+
+struct Call {
+	NodeId<Expression> callee;
+	ExpressionList arguments;
 };
 
 union ExpressionValue {
 	IntLiteral int_literal;
+	FloatLiteral float_literal;
+	StringLiteral string_literal;
 	Identifier identifier;
 	Binary binary;
 	Tagged tagged;
+	Unary unary;
+	Accessed accessed;
+	Call call;
 	Nothing nothing;
 	Invalid invalid;
 };
@@ -149,26 +183,53 @@ struct Expression {
 	ExpressionValue value;
 };
 
-struct ExpressionList {
-	std::vector<usize> expr_list_idx;
-};
-
 struct SyntaxTree {
 	ExpressionList expression_list;
 };
 
+/// How Parser::parse keeps track of nested expressions, both build the
+/// same nodes in the same order and report the same errors
+enum class ParseMode {
+	/// One native call per nesting level, the native stack limits the
+	/// depth to some tens of thousands of levels
+	recursive,
+	/// Nesting levels are frames of a heap allocated stack, any depth
+	/// that fits in memory parses
+	explicit_stack,
+};
+
+enum class ErrorCode : i16 {
+	/// Integer literal that does not fit in u64, or a base prefix
+	/// without digits
+	invalid_int_literal,
+	/// A token that can not start an expression where one is needed
+	expected_expression,
+	/// A dot not followed by a field name
+	expected_identifier,
+	/// A parenthesis left open at the end of the source
+	unclosed_parenthesis,
+	/// A token following a complete expression that neither continues
+	/// it nor separates it from the next, skipped up to the next
+	/// separator
+	unexpected_token,
+};
+
 struct SyntaxError {
-	i16 error_code;
+	ErrorCode error_code;
+	/// Byte offset of the offending token
+	usize offset;
+
+	bool operator==(SyntaxError const &) const = default;
 };
 
 Expression make_invalid() {
 	return {.kind = ExpressionKind::invalid, .value = {}};
 }
 
-Expression make_tagged(Identifier tag, usize expr_idx) {
+Expression make_tagged(Identifier tag, NodeId<Expression> expr) {
 	return {
 		.kind = ExpressionKind::tagged,
-		.value = {.tagged = {.tag = tag, .expr_idx = expr_idx}}
+		.value = {.tagged = {.tag = tag, .expr = expr}}
 	};
 }
 
@@ -179,244 +240,1035 @@ Expression make_identifier(Identifier tag) {
 	};
 }
 
-Expression make_int_literal(u64 value, usize token_idx) {
-	std::println("making literal {} {}", value, token_idx);
-	std::cout.flush();
+Expression make_int_literal(u64 value, usize offset) {
 	return {
 		.kind = ExpressionKind::int_literal,
 		.value = {
-			.int_literal = {.value = value, .token_idx = token_idx}
+			.int_literal = {.value = value, .offset = offset}
 		}
 	};
 }
 
 Expression
-make_binary(TokenKind op, usize lhs_expr_idx, usize rhs_expr_idx) {
+make_float_literal(ExpressionKind kind, f64 value, usize offset) {
 	return {
-		.kind = ExpressionKind::binary,
+		.kind = kind,
 		.value = {
-			.binary = {
-				.op = op,
-				.lhs_expr_idx = lhs_expr_idx,
-				.rhs_expr_idx = rhs_expr_idx
-			}
+			.float_literal = {.value = value, .offset = offset}
 		}
 	};
 }
 
-struct Parser {
+Expression make_string_literal(usize offset) {
+	return {
+		.kind = ExpressionKind::string_literal,
+		.value = {.string_literal = {.offset = offset}}
+	};
+}
+
+Expression make_unary(TokenKind op, NodeId<Expression> operand) {
+	return {
+		.kind = ExpressionKind::unary,
+		.value = {.unary = {.op = op, .operand = operand}}
+	};
+}
+
+Expression make_accessed(NodeId<Expression> prefix, Identifier field) {
+	return {
+		.kind = ExpressionKind::accessed,
+		.value = {.accessed = {.prefix = prefix, .field = field}}
+	};
+}
+
+Expression make_call(NodeId<Expression> callee, ExpressionList arguments) {
+	return {
+		.kind = ExpressionKind::call,
+		.value = {.call = {.callee = callee, .arguments = arguments}}
+	};
+}
+
+Expression
+make_binary(TokenKind op, NodeId<Expression> lhs, NodeId<Expression> rhs) {
+	return {
+		.kind = ExpressionKind::binary,
+		.value = {.binary = {.op = op, .lhs = lhs, .rhs = rhs}}
+	};
+}
+
+/// Expressions stored as a struct of arrays: a u8 tag and an 8 byte
+/// payload per node, plus extra data for what does not fit in the
+/// payload. Every node pays 9 bytes whatever its kind, a walk over
+/// kinds and children touches the first two arrays only.
+///
+/// A NodeId<Expression> is the index of the node in both arrays. Each
+/// array lives in its own NodeArena, so nodes never move as the store
+/// grows.
+///
+///   kind              payload            extra
+///   int_literal       offset, extra      u64 value
+///   float_literal     offset, extra      f64 value
+///   imaginary_literal offset, extra      f64 value
+///   string_literal    offset
+///   identifier        offset, symbol
+///   tagged            expr, extra        tag offset, symbol
+///   unary             operand, operator
+///   accessed          prefix, extra      field offset, symbol
+///   call              callee, extra      argument list
+///   binary            lhs, rhs           (operator in the tag)
+///   nothing, invalid
+struct ExpressionStore {
+	/// Binary expressions are tagged BINARY + their operator, tags
+	/// below it are ExpressionKind values
+	static constexpr u8 BINARY = 16;
+
+	struct Payload {
+		u32 first;
+		u32 second;
+	};
+
   private:
-	Tokenizer tokenizer;
-	std::vector<Token> tokens;
-	std::vector<SyntaxError> errors;
-	std::vector<Expression> expressions;
+	NodeArena tags;
+	NodeArena payloads;
+	NodeArena extra;
+	u32 count = 0;
+
+	/// Identifier as kept in extra data
+	struct PackedIdentifier {
+		u32 offset;
+		u32 symbol;
+	};
+
+	template <typename T> u32 push_extra(T const & value) {
+		return extra.push(value).offset;
+	}
+
+	template <typename T> T const & get_extra(u32 offset) const {
+		return extra[NodeId<T>{.offset = offset}];
+	}
 
-	usize cursor = 0;
+	static PackedIdentifier pack(Identifier identifier) {
+		return {
+			.offset = (u32)identifier.offset,
+			.symbol = identifier.symbol
+		};
+	}
 
-	usize push_expression(Expression expression) {
-		// std::println("pushing expression {}", expression);
-		std::println("pushing expression");
-		expressions.push_back(expression);
-		return expressions.size() - 1;
+	static Identifier unpack(PackedIdentifier identifier) {
+		return {
+			.offset = identifier.offset, .symbol = identifier.symbol
+		};
 	}
 
   public:
-	Parser(String source) : tokenizer(source) {
-		Token token;
-		do {
-			token = tokenizer.next_token();
-			tokens.push_back(token);
-		} while (token.kind != TokenKind::eof);
+	NodeId<Expression> push(u8 tag, Payload payload) {
+		tags.push(tag);
+		payloads.push(payload);
+		return {.offset = count++};
 	}
 
-	SyntaxTree parse() {
-		auto expression_list = parse_expression_list(TokenKind::eof);
-		return {.expression_list = expression_list};
+	NodeId<Expression> push(Expression const & expression) {
+		ExpressionValue const & value = expression.value;
+		switch (expression.kind) {
+		case ExpressionKind::int_literal:
+			return push(
+				(u8)expression.kind,
+				{(u32)value.int_literal.offset,
+				 push_extra<u64>(value.int_literal.value)}
+			);
+		case ExpressionKind::float_literal:
+		case ExpressionKind::imaginary_literal:
+			return push(
+				(u8)expression.kind,
+				{(u32)value.float_literal.offset,
+				 push_extra<f64>(value.float_literal.value)}
+			);
+		case ExpressionKind::string_literal:
+			return push(
+				(u8)expression.kind, {(u32)value.string_literal.offset, 0}
+			);
+		case ExpressionKind::identifier:
+			return push(
+				(u8)expression.kind,
+				{(u32)value.identifier.offset, value.identifier.symbol}
+			);
+		case ExpressionKind::tagged:
+			return push(
+				(u8)expression.kind,
+				{value.tagged.expr.offset, push_extra(pack(value.tagged.tag))}
+			);
+		case ExpressionKind::unary:
+			return push(
+				(u8)expression.kind,
+				{value.unary.operand.offset, (u32)value.unary.op}
+			);
+		case ExpressionKind::accessed:
+			return push(
+				(u8)expression.kind,
+				{value.accessed.prefix.offset,
+				 push_extra(pack(value.accessed.field))}
+			);
+		case ExpressionKind::call:
+			return push(
+				(u8)expression.kind,
+				{value.call.callee.offset,
+				 push_extra(value.call.arguments.expressions)}
+			);
+		case ExpressionKind::binary:
+			return push(
+				(u8)(BINARY + (u8)value.binary.op),
+				{value.binary.lhs.offset, value.binary.rhs.offset}
+			);
+		case ExpressionKind::nothing:
+		case ExpressionKind::invalid:
+			break;
+		}
+		return push((u8)expression.kind, {0, 0});
+	}
+
+	/// Copies `expressions` next to each other in the extra data
+	NodeList<NodeId<Expression>>
+	push_list(std::span<const NodeId<Expression>> expressions) {
+		return extra.push(expressions);
+	}
+
+	std::span<const NodeId<Expression>>
+	list(NodeList<NodeId<Expression>> expressions) const {
+		return extra[expressions];
+	}
+
+	u8 tag(NodeId<Expression> id) const {
+		return tags[NodeId<u8>{.offset = id.offset}];
+	}
+
+	Payload payload(NodeId<Expression> id) const {
+		return payloads[NodeId<Payload>{.offset = id.offset * 8}];
+	}
+
+	ExpressionKind kind(NodeId<Expression> id) const {
+		u8 node_tag = tag(id);
+		return node_tag >= BINARY ? ExpressionKind::binary
+								  : (ExpressionKind)node_tag;
+	}
+
+	/// Operator of a binary expression
+	TokenKind binary_op(NodeId<Expression> id) const {
+		return (TokenKind)(tag(id) - BINARY);
+	}
+
+	/// Expression `id` decoded from the arrays
+	Expression operator[](NodeId<Expression> id) const {
+		u8 node_tag = tag(id);
+		Payload data = payload(id);
+		if (node_tag >= BINARY) {
+			return make_binary(
+				binary_op(id), {.offset = data.first}, {.offset = data.second}
+			);
+		}
+		switch ((ExpressionKind)node_tag) {
+		case ExpressionKind::int_literal:
+			return make_int_literal(get_extra<u64>(data.second), data.first);
+		case ExpressionKind::float_literal:
+		case ExpressionKind::imaginary_literal:
+			return make_float_literal(
+				(ExpressionKind)node_tag,
+				get_extra<f64>(data.second),
+				data.first
+			);
+		case ExpressionKind::string_literal:
+			return make_string_literal(data.first);
+		case ExpressionKind::identifier:
+			return make_identifier(
+				{.offset = data.first, .symbol = data.second}
+			);
+		case ExpressionKind::tagged:
+			return make_tagged(
+				unpack(get_extra<PackedIdentifier>(data.second)),
+				{.offset = data.first}
+			);
+		case ExpressionKind::unary:
+			return make_unary((TokenKind)data.second, {.offset = data.first});
+		case ExpressionKind::accessed:
+			return make_accessed(
+				{.offset = data.first},
+				unpack(get_extra<PackedIdentifier>(data.second))
+			);
+		case ExpressionKind::call:
+			return make_call(
+				{.offset = data.first},
+				{.expressions = get_extra<NodeList<NodeId<Expression>>>(
+					 data.second
+				 )}
+			);
+		case ExpressionKind::binary:
+		case ExpressionKind::nothing:
+		case ExpressionKind::invalid:
+			break;
+		}
+		return {.kind = (ExpressionKind)node_tag, .value = {}};
 	}
 
-	const Expression & get_expression(usize expr_idx) const {
-		return expressions[expr_idx];
+	/// Nodes and extra data pushed up to some point, see append
+	struct Mark {
+		u32 node;
+		u32 extra;
+	};
+
+	/// Current end of the store. The extra data is padded to 8 bytes
+	/// first, so the data pushed after the mark can be copied elsewhere
+	/// with its alignment.
+	Mark mark() {
+		return {.node = count, .extra = extra.push_bytes({}, 8)};
 	}
 
-	const std::vector<Token> get_tokens() const { return tokens; }
+	/// Copies the nodes of `other` between `first` and `last`, and the
+	/// extra data between them, after the nodes of the store. Children
+	/// of the copied nodes must be copied with them. Returns the shift
+	/// to add to the ids of the copied nodes, modulo 2^32.
+	u32 append(ExpressionStore const & other, Mark first, Mark last) {
+		u32 size = last.node - first.node;
+		NodeList<u8> node_tags = {.offset = first.node, .size = size};
+		NodeList<Payload> node_payloads = {
+			.offset = first.node * 8, .size = size
+		};
+		NodeList<u8> node_extra = {
+			.offset = first.extra, .size = last.extra - first.extra
+		};
+		tags.push(other.tags[node_tags]);
+		payloads.push(other.payloads[node_payloads]);
+		u32 extra_offset = extra.push_bytes(other.extra[node_extra], 8);
+
+		u32 node_shift = count - first.node;
+		u32 extra_shift = extra_offset - first.extra;
+		for (u32 node = count; node < count + size; ++node) {
+			NodeId<Expression> id = {.offset = node};
+			Payload & data = payloads[NodeId<Payload>{.offset = node * 8}];
+			if (tag(id) >= BINARY) {
+				data.first += node_shift;
+				data.second += node_shift;
+				continue;
+			}
+			switch ((ExpressionKind)tag(id)) {
+			case ExpressionKind::int_literal:
+			case ExpressionKind::float_literal:
+			case ExpressionKind::imaginary_literal:
+				data.second += extra_shift;
+				break;
+			case ExpressionKind::tagged:
+				if (data.first != NodeId<Expression>::NONE) {
+					data.first += node_shift;
+				}
+				data.second += extra_shift;
+				break;
+			case ExpressionKind::unary:
+				data.first += node_shift;
+				break;
+			case ExpressionKind::accessed:
+				data.first += node_shift;
+				data.second += extra_shift;
+				break;
+			case ExpressionKind::call: {
+				data.first += node_shift;
+				data.second += extra_shift;
+				auto & arguments = extra[NodeId<NodeList<NodeId<Expression>>>{
+					.offset = data.second
+				}];
+				arguments.offset += extra_shift;
+				for (NodeId<Expression> & argument : extra[arguments]) {
+					argument.offset += node_shift;
+				}
+				break;
+			}
+			case ExpressionKind::string_literal:
+			case ExpressionKind::identifier:
+			case ExpressionKind::binary:
+			case ExpressionKind::nothing:
+			case ExpressionKind::invalid:
+				break;
+			}
+		}
+		count += size;
+		return node_shift;
+	}
+
+	usize size() const { return count; }
+
+	/// Bytes taken by nodes and their extra data
+	usize memory() const {
+		return tags.size() + payloads.size() + extra.size();
+	}
+};
+
+/// Token indices splitting `tokens` into runs of whole top level
+/// expressions, about `parts` of them: 0 first, the index of eof last.
+///
+/// Splits are only made after a comma or a run of new lines outside
+/// parentheses, and not where a new line continues an expression: after
+/// an operator or before a pipe. Errors never stop the parser beyond
+/// such a separator, so each run parses on its own the way it does in
+/// the whole list.
+std::vector<usize> top_level_splits(TokenStream const & tokens, usize parts) {
+	usize eof = tokens.size() - 1;
+	usize step = std::max<usize>(1, eof / std::max<usize>(1, parts));
+	std::vector<usize> splits = {0};
+	usize depth = 0;
+	/// Last token before the current run of new lines
+	TokenKind previous = TokenKind::new_line;
+	for (usize i = 0; i + 1 < eof; ++i) {
+		TokenKind kind = tokens.kind(i);
+		if (kind == TokenKind::lparen) {
+			depth += 1;
+		} else if (kind == TokenKind::rparen and depth > 0) {
+			depth -= 1;
+		}
+		bool split = false;
+		if (kind == TokenKind::comma) {
+			split = true;
+		} else if (kind == TokenKind::new_line) {
+			TokenKind next = tokens.kind(i + 1);
+			split = next != TokenKind::new_line and next != TokenKind::pipe and
+					INFIX_POWERS[(usize)previous].left == 0 and
+					not is_prefix_operator(previous);
+		} else {
+			previous = kind;
+		}
+		if (split and depth == 0 and i + 1 >= splits.back() + step) {
+			splits.push_back(i + 1);
+		}
+	}
+	splits.push_back(eof);
+	return splits;
+}
+
+/// Parser pulling its tokens from `Tokens`, a TokenBuffer, TokenRing
+/// or TokenSlice
+template <typename Tokens> struct BasicParser {
+	/// Parts of the top level list per thread in a parallel parse, to
+	/// even out the load
+	static constexpr usize PARTS_PER_THREAD = 4;
 
   private:
-	/// ExpressionList
-	ExpressionList parse_expression_list(TokenKind end_token_kind) {
+	template <typename> friend struct BasicParser;
 
-		std::vector<usize> expr_list_idx;
-		expr_list_idx.push_back(
-			push_expression(parse_complex_expression())
-		);
-		cursor += 1;
-		while (tokens[cursor].kind != end_token_kind) {
-			if (tokens[cursor].kind == TokenKind::comma or
-				tokens[cursor].kind == TokenKind::new_line) {
-				cursor += 1;
-				skip_newlines();
+	String source;
+	Interner interner;
+	/// Decoded string literals with escapes
+	Arena strings;
+	Tokens tokens;
+	std::vector<SyntaxError> errors;
+	/// Expressions and expression lists, freed with the parser
+	ExpressionStore nodes;
+	/// Expressions of the lists being parsed, innermost list last, each
+	/// list is copied to the arena once complete
+	std::vector<NodeId<Expression>> pending;
 
-				expr_list_idx.push_back(
-					push_expression(parse_complex_expression())
-				);
-				cursor += 1;
-			} else {
-				// TODO: handle error properly
+	NodeId<Expression> push_expression(Expression expression) {
+		return nodes.push(expression);
+	}
+
+  public:
+	/// A TokenBuffer lexes the whole source here, a TokenRing only the
+	/// first tokens
+	BasicParser(String source)
+		: source(source), tokens(source, &interner) {}
+
+	/// Parses part of a stream lexed elsewhere, its identifiers keep
+	/// the symbols of that stream's interner
+	BasicParser(String source, TokenSlice tokens)
+		requires std::same_as<Tokens, TokenSlice>
+		: source(source), tokens(tokens) {}
+
+	// the token source may point at the interner, which must not move
+	BasicParser(BasicParser const &) = delete;
+	BasicParser(BasicParser &&) = delete;
+	BasicParser & operator=(BasicParser const &) = delete;
+	BasicParser & operator=(BasicParser &&) = delete;
+
+	SyntaxTree parse(ParseMode mode = ParseMode::recursive) {
+		if (mode == ParseMode::explicit_stack) {
+			return parse_with_stack();
+		}
+		auto expression_list = parse_expression_list(TokenKind::eof);
+		return {.expression_list = expression_list};
+	}
+
+	/// Parses runs of top level expressions on `pool`, see
+	/// top_level_splits. Each thread parses into its own store, the
+	/// results are copied in source order. Nodes and errors are the
+	/// ones of `parse(mode)`, only the extra data is laid out
+	/// differently.
+	SyntaxTree parse(ThreadPool & pool, ParseMode mode = ParseMode::recursive)
+		requires std::same_as<Tokens, TokenBuffer>
+	{
+		if (pool.size() == 1) {
+			// nothing to gain from copying the parts
+			return parse(mode);
+		}
+		TokenStream const & stream = tokens.stream();
+		std::vector<usize> splits =
+			top_level_splits(stream, pool.size() * PARTS_PER_THREAD);
+
+		struct Part {
+			usize worker;
+			ExpressionStore::Mark first;
+			ExpressionStore::Mark last;
+			ExpressionList expressions;
+			usize first_error;
+			usize last_error;
+		};
+		std::vector<Part> parts(splits.size() - 1);
+		std::vector<std::optional<BasicParser<TokenSlice>>> workers(
+			pool.size()
+		);
+		pool.for_each(parts.size(), [&](usize worker, usize index) {
+			TokenSlice slice(stream, splits[index], splits[index + 1]);
+			if (not workers[worker]) {
+				workers[worker].emplace(source, slice);
 			}
+			BasicParser<TokenSlice> & parser = *workers[worker];
+			parser.tokens = slice;
 
-			if (cursor >= tokens.size()) {
-				break;
+			Part & part = parts[index];
+			part.worker = worker;
+			part.first = parser.nodes.mark();
+			part.first_error = parser.errors.size();
+			part.expressions = parser.parse(mode).expression_list;
+			// the list is the last thing pushed
+			part.last = {
+				.node = (u32)parser.nodes.size(),
+				.extra = part.expressions.expressions.offset
+			};
+			part.last_error = parser.errors.size();
+		});
+
+		for (Part const & part : parts) {
+			BasicParser<TokenSlice> const & parser = *workers[part.worker];
+			u32 shift = nodes.append(parser.nodes, part.first, part.last);
+			for (NodeId<Expression> id :
+				 parser.get_expressions(part.expressions)) {
+				pending.push_back({.offset = id.offset + shift});
 			}
+			errors.insert(
+				errors.end(),
+				parser.errors.begin() + (isize)part.first_error,
+				parser.errors.begin() + (isize)part.last_error
+			);
 		}
+		auto list = nodes.push_list(pending);
+		pending.clear();
+		return {.expression_list = {.expressions = list}};
+	}
+
+	Expression get_expression(NodeId<Expression> id) const {
+		return nodes[id];
+	}
+
+	std::span<const NodeId<Expression>>
+	get_expressions(ExpressionList list) const {
+		return nodes.list(list.expressions);
+	}
+
+	ExpressionStore const & get_nodes() const { return nodes; }
+
+	/// Every token of the source, comments excluded
+	TokenStream const & get_tokens() const
+		requires std::same_as<Tokens, TokenBuffer>
+	{
+		return tokens.stream();
+	}
+
+	/// Number of tokens lexed, comments excluded. All of them once the
+	/// source is parsed.
+	usize get_token_count() const { return tokens.count(); }
+
+	std::span<const LexicalError> get_lexical_errors() const {
+		return tokens.errors();
+	}
+
+	Interner const & get_interner() const { return interner; }
+
+	/// Source text of the token at `offset`, lexed again
+	String get_text(usize offset) const {
+		return token_at(source, offset).value;
+	}
+
+	/// Contents of a string literal with its escapes decoded, empty if
+	/// an escape is malformed. Decoded on every call, literals without
+	/// escapes point into the source.
+	std::optional<String> get_string(StringLiteral literal) {
+		return unescape_string(get_text(literal.offset), strings);
+	}
+
+	std::vector<SyntaxError> const & get_errors() const { return errors; }
+
+  private:
+	TokenKind current() const { return tokens.kind(); }
 
-		return {.expr_list_idx = expr_list_idx};
+	/// Moves to the next token, eof is never passed
+	void advance() { tokens.advance(); }
+
+	void error(ErrorCode code, usize offset) {
+		errors.push_back({.error_code = code, .offset = offset});
 	}
 
 	void skip_newlines() {
-		while (tokens[cursor].kind == TokenKind::new_line) {
-			cursor += 1;
+		while (current() == TokenKind::new_line) {
+			advance();
+		}
+	}
+
+	static bool is_separator(TokenKind kind) {
+		return kind == TokenKind::comma or kind == TokenKind::new_line;
+	}
+
+	/// ExpressionList
+	///   : (ComplexExpression ((',' | new_line) ComplexExpression)*)?
+	///     (',' | new_line)?
+	///   ;
+	///
+	/// Stops before `end`, or at eof
+	ExpressionList parse_expression_list(TokenKind end) {
+		usize first = pending.size();
+		skip_newlines();
+		while (current() != end and current() != TokenKind::eof) {
+			pending.push_back(parse_complex_expression());
+			end_list_item(end);
+		}
+
+		auto list = nodes.push_list(
+			std::span<const NodeId<Expression>>(pending).subspan(first)
+		);
+		pending.resize(first);
+		return {.expressions = list};
+	}
+
+	/// Skips what follows an expression of a list up to the next one
+	void end_list_item(TokenKind end) {
+		if (not is_separator(current()) and current() != end and
+			current() != TokenKind::eof) {
+			error(ErrorCode::unexpected_token, tokens.start());
+			while (not is_separator(current()) and current() != end and
+				   current() != TokenKind::eof) {
+				advance();
+			}
+		}
+		if (is_separator(current())) {
+			advance();
+			skip_newlines();
 		}
 	}
 
 	/// ComplexExpression
-	///   : TaggedExpression
+	///   : Identifier ':' Expression?
 	///   | Expression
 	///   ;
-	Expression parse_complex_expression() {
-		switch (tokens[cursor].kind) {
-		case TokenKind::identifier: {
-			if (tokens[cursor + 1].kind == TokenKind::colon) {
-				// Tagged Expression
-				// identifier: basic_expression
-				Identifier tag(cursor);
-				cursor += 2;
-				usize expr_idx = push_expression(parse_expression());
-				return make_tagged(tag, expr_idx);
-			} // if not follow through and parse expression
+	NodeId<Expression> parse_complex_expression() {
+		if (current() == TokenKind::identifier and
+			tokens.next_kind() == TokenKind::colon) {
+			Identifier tag = identifier();
+			advance();
+			advance();
+			NodeId<Expression> expr;
+			if (not is_separator(current()) and current() != TokenKind::eof) {
+				expr = parse_expression(0);
+			}
+			return push_expression(make_tagged(tag, expr));
 		}
-		default:
-			return parse_expression();
-			// }
+		return parse_expression(0);
+	}
+
+	/// Infix operator at the cursor, a pipe at the start of the next
+	/// line continues the expression across the new lines
+	TokenKind infix_operator() {
+		if (current() == TokenKind::new_line and
+			tokens.next_kind() == TokenKind::pipe) {
+			skip_newlines();
 		}
+		return current();
 	}
 
 	/// Expression
-	///   : Binding
-	///   | PrimaryExpression Extension
+	///   : Prefix (Postfix | InfixOperator Expression)*
 	///   ;
-	Expression parse_expression() {
-		// TODO: if token is binding then parse as binding (don't
-		// allow extensions)
-		//
-		std::println("parse expression");
-		std::cout.flush();
-		Expression lhs_expr = parse_primary_expression();
-		cursor += 1;
-		return parse_extension(
-			0, lhs_expr
-		); // precedence 0 is the starting expression
-	}
-
-	Expression
-	parse_extension(i8 last_precedence, Expression lhs_expr) {
+	///
+	/// Precedence climbing: operators binding looser than
+	/// `min_power` end the expression and are left to the caller.
+	/// Access and call postfixes bind tighter than everything, they are
+	/// taken whatever `min_power` is. Every token is looked at once,
+	/// there is no backtracking.
+	NodeId<Expression> parse_expression(u8 min_power) {
+		NodeId<Expression> lhs = parse_prefix();
 		while (true) {
-			i8 current_precedence =
-				get_token_precedence(tokens[cursor].kind);
-			if (last_precedence < current_precedence) {
-				// new token is lower precedence than existing stop
-				// consuming;
-				return lhs_expr;
+			TokenKind op = infix_operator();
+			if (op == TokenKind::dot) {
+				lhs = parse_access(lhs);
+				continue;
 			}
-
-			switch (tokens[cursor].kind) {
-			case TokenKind::dot:
-				// handle accessed expression
-			case TokenKind::lparen:
-				// handle call expression
-			default: { // we know this is a binary expression
-				TokenKind op = tokens[cursor].kind;
-				cursor += 1;
-				Expression rhs_expr = parse_primary_expression();
-				i8 next_precedence =
-					get_token_precedence(tokens[cursor + 1].kind);
-				if (current_precedence < next_precedence) {
-					rhs_expr = parse_extension(
-						current_precedence + 1, rhs_expr
-					);
-				}
-				lhs_expr = make_binary(
-					tokens[cursor].kind,
-					push_expression(lhs_expr),
-					push_expression(rhs_expr)
-				);
+			if (op == TokenKind::lparen) {
+				lhs = parse_call(lhs);
+				continue;
 			}
+			BindingPower power = INFIX_POWERS[(usize)op];
+			if (power.left == 0 or power.left < min_power) {
+				return lhs;
 			}
+			advance();
+			skip_newlines();
+			NodeId<Expression> rhs = parse_expression(power.right);
+			lhs = push_expression(make_binary(op, lhs, rhs));
 		}
 	}
 
-	/// PrimaryExpression
+	/// Prefix
 	///   : Literal
 	///   | Identifier
-	///   | ParenthesizedExpression
-	///   | Positional
+	///   | '(' ComplexExpression ')'
+	///   | PrefixOperator Expression
 	///   ;
-	///
-	Expression parse_primary_expression() {
-		switch (tokens[cursor].kind) {
+	NodeId<Expression> parse_prefix() {
+		TokenKind kind = current();
+		if (is_prefix_operator(kind)) {
+			advance();
+			NodeId<Expression> operand = parse_expression(PREFIX_POWER);
+			return push_expression(make_unary(kind, operand));
+		}
+		if (kind == TokenKind::lparen) {
+			return parse_parenthesis();
+		}
+		return parse_operand();
+	}
+
+	/// Prefix that is neither an operator nor a parenthesis, the ones
+	/// with nothing nested
+	NodeId<Expression> parse_operand() {
+		TokenKind kind = current();
+		Expression expression = make_invalid();
+		switch (kind) {
 		case TokenKind::int_literal:
 		case TokenKind::hex_literal:
 		case TokenKind::oct_literal:
 		case TokenKind::bin_literal:
-			return parse_int_literal();
+			expression = parse_int_literal();
+			break;
+		case TokenKind::float_literal:
+		case TokenKind::imaginary_literal:
+			expression = parse_float_literal();
+			break;
+		case TokenKind::string_literal:
+			expression = make_string_literal(tokens.start());
+			break;
 		case TokenKind::identifier:
-			return parse_identifier();
-		case TokenKind::lparen:
-			return parse_parenthesis();
-		case TokenKind::plus:
-		case TokenKind::minus:
-		case TokenKind::times:
-		case TokenKind::by:
-		case TokenKind::exponent:
-		case TokenKind::kword_or:
-		case TokenKind::kword_and:
-		case TokenKind::mod:
-		case TokenKind::lshift:
-		case TokenKind::rshift:
-		case TokenKind::band:
-		case TokenKind::bor:
-		case TokenKind::bxor:
-		case TokenKind::bnot:
-		case TokenKind::eq:
-		case TokenKind::ge:
-		case TokenKind::gt:
-		case TokenKind::le:
-		case TokenKind::lt:
-			return parse_unary();
+			expression = make_identifier(identifier());
+			break;
 		default:
-			return make_invalid();
+			error(ErrorCode::expected_expression, tokens.start());
+			// separators and closing tokens are left to the enclosing
+			// list
+			if (not is_separator(kind) and kind != TokenKind::rparen) {
+				advance();
+			}
+			return push_expression(make_invalid());
+		}
+		advance();
+		return push_expression(expression);
+	}
+
+	/// Skips what is left inside a parenthesis after its expression
+	void close_parenthesis(usize open) {
+		skip_newlines();
+		if (current() != TokenKind::rparen and current() != TokenKind::eof) {
+			error(ErrorCode::unexpected_token, tokens.start());
+			while (current() != TokenKind::rparen and
+				   current() != TokenKind::eof) {
+				advance();
+			}
+		}
+		expect_rparen(open);
+	}
+
+	/// Consumes the closing parenthesis of the one opened at `open`
+	void expect_rparen(usize open) {
+		if (current() == TokenKind::rparen) {
+			advance();
+		} else {
+			error(ErrorCode::unclosed_parenthesis, open);
 		}
 	}
 
-	Expression parse_unary() { return {}; }
+	NodeId<Expression> parse_parenthesis() {
+		usize open = tokens.start();
+		advance();
+		skip_newlines();
+		NodeId<Expression> expression = parse_complex_expression();
+		close_parenthesis(open);
+		return expression;
+	}
+
+	/// Postfix: '.' Identifier
+	NodeId<Expression> parse_access(NodeId<Expression> prefix) {
+		advance();
+		if (current() != TokenKind::identifier) {
+			error(ErrorCode::expected_identifier, tokens.start());
+			return prefix;
+		}
+		Identifier field = identifier();
+		advance();
+		return push_expression(make_accessed(prefix, field));
+	}
+
+	/// Postfix: '(' ExpressionList ')'
+	NodeId<Expression> parse_call(NodeId<Expression> callee) {
+		usize open = tokens.start();
+		advance();
+		ExpressionList arguments = parse_expression_list(TokenKind::rparen);
+		expect_rparen(open);
+		return push_expression(make_call(callee, arguments));
+	}
+
+	/// Parsing rule waiting for a nested one to complete, see
+	/// parse_with_stack
+	struct Frame {
+		enum class Kind : u8 {
+			/// ExpressionList ending at `op`, its expressions so far are
+			/// pending from index `first`
+			list,
+			/// ComplexExpression tagged by the identifier `symbol` at
+			/// `first`
+			tagged,
+			/// Expression of operators binding at least `power`, `node`
+			/// is its left hand side once known and `op` the operator
+			/// waiting for a right hand side
+			expression,
+			/// PrefixOperator `op`
+			unary,
+			/// Parenthesis opened at `first`
+			parenthesis,
+			/// Call of `node` opened at `first`, the argument list is the
+			/// frame above
+			call,
+		};
 
-	Expression parse_parenthesis() {
-		// skip lparen token
-		Expression expression = parse_complex_expression();
-		return {};
+		Kind kind;
+		u8 power = 0;
+		TokenKind op = TokenKind::invalid;
+		usize first = 0;
+		NodeId<Expression> node = {};
+		u32 symbol = Interner::NO_SYMBOL;
+	};
+
+	/// ParseMode::explicit_stack: the rules of parse_expression_list and
+	/// below, with every rule waiting on a nested one kept as a Frame
+	/// instead of a native call. The tokens are consumed and the nodes
+	/// and errors pushed in the same order as the recursive rules.
+	SyntaxTree parse_with_stack() {
+		enum class Step {
+			/// Next expression of the list on top, or its end
+			list,
+			complex_expression,
+			/// Expression binding at least `min_power`
+			expression,
+			/// Postfixes and infix operators after the left hand side of
+			/// the expression on top
+			infix,
+			/// `value` completes the rule on top
+			value,
+		};
+
+		std::vector<Frame> stack;
+		Step step = Step::list;
+		u8 min_power = 0;
+		NodeId<Expression> value;
+
+		auto open_list = [&](TokenKind end) {
+			stack.push_back(
+				{.kind = Frame::Kind::list, .op = end, .first = pending.size()}
+			);
+			skip_newlines();
+		};
+		open_list(TokenKind::eof);
+
+		while (true) {
+			switch (step) {
+			case Step::list: {
+				Frame list_frame = stack.back();
+				if (current() != list_frame.op and
+					current() != TokenKind::eof) {
+					step = Step::complex_expression;
+					break;
+				}
+				auto list = nodes.push_list(
+					std::span<const NodeId<Expression>>(pending).subspan(
+						list_frame.first
+					)
+				);
+				pending.resize(list_frame.first);
+				stack.pop_back();
+				if (stack.empty()) {
+					return {.expression_list = {.expressions = list}};
+				}
+				// only calls wait on lists
+				Frame call = stack.back();
+				stack.pop_back();
+				expect_rparen(call.first);
+				stack.back().node = push_expression(
+					make_call(call.node, {.expressions = list})
+				);
+				step = Step::infix;
+				break;
+			}
+			case Step::complex_expression:
+				min_power = 0;
+				step = Step::expression;
+				if (current() == TokenKind::identifier and
+					tokens.next_kind() == TokenKind::colon) {
+					Identifier tag = identifier();
+					advance();
+					advance();
+					if (is_separator(current()) or
+						current() == TokenKind::eof) {
+						value = push_expression(
+							make_tagged(tag, {})
+						);
+						step = Step::value;
+						break;
+					}
+					stack.push_back(
+						{.kind = Frame::Kind::tagged,
+						 .first = tag.offset,
+						 .symbol = tag.symbol}
+					);
+				}
+				break;
+			case Step::expression: {
+				stack.push_back(
+					{.kind = Frame::Kind::expression, .power = min_power}
+				);
+				TokenKind kind = current();
+				if (is_prefix_operator(kind)) {
+					advance();
+					stack.push_back({.kind = Frame::Kind::unary, .op = kind});
+					min_power = PREFIX_POWER;
+				} else if (kind == TokenKind::lparen) {
+					stack.push_back(
+						{.kind = Frame::Kind::parenthesis,
+						 .first = tokens.start()}
+					);
+					advance();
+					skip_newlines();
+					step = Step::complex_expression;
+				} else {
+					value = parse_operand();
+					step = Step::value;
+				}
+				break;
+			}
+			case Step::infix: {
+				Frame & expression = stack.back();
+				TokenKind op = infix_operator();
+				if (op == TokenKind::dot) {
+					expression.node = parse_access(expression.node);
+					break;
+				}
+				if (op == TokenKind::lparen) {
+					NodeId<Expression> callee = expression.node;
+					stack.push_back(
+						{.kind = Frame::Kind::call,
+						 .first = tokens.start(),
+						 .node = callee}
+					);
+					advance();
+					open_list(TokenKind::rparen);
+					step = Step::list;
+					break;
+				}
+				BindingPower power = INFIX_POWERS[(usize)op];
+				if (power.left == 0 or power.left < expression.power) {
+					value = expression.node;
+					stack.pop_back();
+					step = Step::value;
+					break;
+				}
+				advance();
+				skip_newlines();
+				expression.op = op;
+				min_power = power.right;
+				step = Step::expression;
+				break;
+			}
+			case Step::value: {
+				Frame & frame = stack.back();
+				switch (frame.kind) {
+				case Frame::Kind::list:
+					pending.push_back(value);
+					end_list_item(frame.op);
+					step = Step::list;
+					break;
+				case Frame::Kind::tagged:
+					value = push_expression(
+						make_tagged(
+							{.offset = frame.first, .symbol = frame.symbol},
+							value
+						)
+					);
+					stack.pop_back();
+					break;
+				case Frame::Kind::expression:
+					if (frame.node.valid()) {
+						value = push_expression(
+							make_binary(frame.op, frame.node, value)
+						);
+					}
+					frame.node = value;
+					step = Step::infix;
+					break;
+				case Frame::Kind::unary:
+					value = push_expression(make_unary(frame.op, value));
+					stack.pop_back();
+					break;
+				case Frame::Kind::parenthesis:
+					close_parenthesis(frame.first);
+					stack.pop_back();
+					break;
+				case Frame::Kind::call:
+					// calls complete in Step::list
+					break;
+				}
+				break;
+			}
+			}
+		}
 	}
 
-	Expression parse_identifier() {
-		// TODO: might be call expressions
-		return make_identifier(Identifier(cursor));
+	/// Identifier at the current token
+	Identifier identifier() const {
+		return {.offset = tokens.start(), .symbol = tokens.symbol()};
 	}
 
 	Expression parse_int_literal() {
-		return make_int_literal(
-			int_from_token(tokens[cursor]), cursor
+		std::optional<u64> value =
+			int_from_token({.kind = current(), .value = tokens.value()});
+		if (not value) {
+			error(ErrorCode::invalid_int_literal, tokens.start());
+			return make_invalid();
+		}
+		return make_int_literal(*value, tokens.start());
+	}
+
+	Expression parse_float_literal() {
+		ExpressionKind kind = current() == TokenKind::float_literal
+								  ? ExpressionKind::float_literal
+								  : ExpressionKind::imaginary_literal;
+		return make_float_literal(
+			kind, float_from_string(tokens.value()), tokens.start()
 		);
 	}
 };
+
+/// Lexes the whole source before parsing, tokens stay accessible
+using Parser = BasicParser<TokenBuffer>;
+/// Lexes as it parses, only holds the tokens it looks at
+using StreamingParser = BasicParser<TokenRing>;
+
 }; // namespace syntax
-   //
 
 template <> struct std::formatter<syntax::ExpressionKind> {
 	constexpr auto parse(std::format_parse_context & ctx) {
@@ -431,12 +1283,27 @@ template <> struct std::formatter<syntax::ExpressionKind> {
 		case syntax::ExpressionKind::int_literal:
 			name = "int_literal";
 			break;
+		case syntax::ExpressionKind::float_literal:
+			name = "float_literal";
+			break;
+		case syntax::ExpressionKind::imaginary_literal:
+			name = "imaginary_literal";
+			break;
+		case syntax::ExpressionKind::string_literal:
+			name = "string_literal";
+			break;
 		case syntax::ExpressionKind::identifier:
 			name = "identifier";
 			break;
 		case syntax::ExpressionKind::tagged:
 			name = "tagged";
 			break;
+		case syntax::ExpressionKind::unary:
+			name = "unary";
+			break;
+		case syntax::ExpressionKind::call:
+			name = "call";
+			break;
 		case syntax::ExpressionKind::nothing:
 			name = "nothing";
 			break;
@@ -465,18 +1332,33 @@ template <> struct std::formatter<syntax::Expression> {
 		const syntax::Expression & expression,
 		std::format_context & ctx
 	) const {
-		string_view value;
+		std::string value;
 		switch (expression.kind) {
 		case syntax::ExpressionKind::int_literal:
 			value =
 				std::format("{}", expression.value.int_literal.value);
 			break;
+		case syntax::ExpressionKind::float_literal:
+			value =
+				std::format("{}", expression.value.float_literal.value);
+			break;
+		case syntax::ExpressionKind::imaginary_literal:
+			value =
+				std::format("{}i", expression.value.float_literal.value);
+			break;
+		case syntax::ExpressionKind::string_literal:
+			value = std::format(
+				"{}", expression.value.string_literal.offset
+			);
+			break;
 		case syntax::ExpressionKind::identifier:
 			value = std::format(
-				"{}", expression.value.identifier.token_idx
+				"{}", expression.value.identifier.offset
 			);
 			break;
 		case syntax::ExpressionKind::tagged:
+		case syntax::ExpressionKind::unary:
+		case syntax::ExpressionKind::call:
 		case syntax::ExpressionKind::nothing:
 		case syntax::ExpressionKind::invalid:
 		case syntax::ExpressionKind::binary:
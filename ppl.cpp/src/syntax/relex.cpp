@@ -0,0 +1,93 @@
+#pragma once
+#include "token_stream.cpp"
+#include "tokenizer.cpp"
+#include <vector>
+
+namespace syntax {
+
+/// Replacement of `removed` bytes at `offset` by `inserted` bytes
+struct Edit {
+	usize offset;
+	usize removed;
+	usize inserted;
+};
+
+/// Updates `tokens` after `edit` turned their source into `source`.
+///
+/// Lexing from a token start always gives the same tokens. Errors also
+/// depend on the bytes before it, a run of ill formed UTF-8 is reported
+/// at its start only, but none goes on past a new line. Relexing starts
+/// at the line holding the edit and goes line by line until it reaches
+/// a line start past the edit where the old stream also had a token
+/// start right after a new line. The old tokens from there on are kept with
+/// their offsets shifted, the ones in between are replaced.
+///
+/// Relexed identifiers are interned into `interner`, which should be
+/// the one `tokens` were produced with. Symbols of removed identifiers
+/// stay interned.
+void relex(
+	TokenStream & tokens,
+	String source,
+	Edit edit,
+	Interner * interner = nullptr
+) {
+	usize line_start = edit.offset;
+	while (line_start > 0 and source[line_start - 1] != '\n') {
+		line_start -= 1;
+	}
+
+	// the eof token starts at the end, there is always a first token
+	usize first = tokens.lower_bound(line_start);
+	isize shift = (isize)edit.inserted - (isize)edit.removed;
+
+	std::vector<Token> relexed;
+	std::vector<LexicalError> errors;
+	usize edit_end = edit.offset + edit.inserted;
+	usize cursor = line_start;
+	while (true) {
+		const void * new_line =
+			memchr(source.data + cursor, '\n', source.size - cursor);
+		usize line_end = new_line == nullptr
+							 ? source.size
+							 : (usize)((const u8 *)new_line - source.data) + 1;
+
+		// lines are tokenized on their own, every line start resets
+		// the tokenizer anyway
+		auto tokenizer =
+			Tokenizer(source.substring(cursor, line_end), interner);
+		Token token;
+		while (true) {
+			token = tokenizer.next_token();
+			token.start += cursor;
+			token.end += cursor;
+			if (token.kind == TokenKind::eof) {
+				break;
+			}
+			relexed.push_back(token);
+		}
+		for (LexicalError error : tokenizer.errors()) {
+			error.offset += cursor;
+			errors.push_back(error);
+		}
+		if (line_end == source.size) {
+			relexed.push_back(token);
+			tokens.splice(source, first, tokens.size(), relexed, errors, 0);
+			return;
+		}
+
+		cursor = line_end;
+		if (cursor >= edit_end) {
+			usize old_cursor = (usize)((isize)cursor - shift);
+			usize last = tokens.lower_bound(old_cursor);
+			if (last > 0 and last < tokens.size() and
+				tokens.start(last) == old_cursor and
+				tokens.kind(last - 1) == TokenKind::new_line and
+				tokens[last - 1].end == old_cursor) {
+				tokens.splice(source, first, last, relexed, errors, shift);
+				return;
+			}
+		}
+	}
+}
+
+}; // namespace syntax
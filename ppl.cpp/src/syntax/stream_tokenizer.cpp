@@ -0,0 +1,124 @@
+#pragma once
+#include "tokenizer.cpp"
+#include <cerrno>
+#include <optional>
+#include <unistd.h>
+#include <vector>
+
+namespace syntax {
+
+/// Tokenizes a file descriptor through a bounded window instead of a
+/// whole source in memory. Token offsets are global to the stream,
+/// token values point into the window and are only valid until the
+/// next call to `next_token`.
+///
+/// A token within LOOKAHEAD bytes of the end of the window may
+/// continue in the next chunk, it is deferred: the window is shifted so
+/// the token starts it, refilled, and lexed again. The window only
+/// grows for a single token larger than itself.
+struct StreamTokenizer {
+	static constexpr usize WINDOW = 1 << 20;
+
+  private:
+	int fd;
+	std::vector<u8> window;
+	/// Stream offset of window[0]
+	usize window_offset = 0;
+	/// Bytes of the window holding data
+	usize filled = 0;
+	bool at_end = false;
+	bool read_failed = false;
+	/// Interns identifiers once they are returned, deferred tokens may
+	/// be cut off and are not interned
+	Interner * interner;
+	std::optional<Tokenizer> tokenizer;
+	/// Errors of the returned tokens, with stream offsets
+	std::vector<LexicalError> lexical_errors;
+	/// Errors of the window tokenizer already moved to lexical_errors
+	usize reported = 0;
+	/// Whether the byte before the window is ill formed UTF-8, so a run
+	/// split by the window start is reported once
+	bool invalid_before_window = false;
+
+	/// Keeps window[keep, filled) at the front of the window and reads
+	/// until it is full or the stream ends
+	void refill(usize keep) {
+		if (keep > 0) {
+			invalid_before_window = tokenizer->ends_invalid_run(keep);
+		}
+		if (keep == 0 and filled == window.size()) {
+			window.resize(window.size() * 2);
+		} else {
+			memmove(window.data(), window.data() + keep, filled - keep);
+			window_offset += keep;
+			filled -= keep;
+		}
+
+		while (filled < window.size()) {
+			ssize_t count =
+				read(fd, window.data() + filled, window.size() - filled);
+			if (count < 0 and errno == EINTR) {
+				continue;
+			}
+			if (count <= 0) {
+				at_end = true;
+				read_failed = count < 0;
+				break;
+			}
+			filled += (usize)count;
+		}
+
+		tokenizer.emplace(String(window.data(), filled));
+		if (invalid_before_window) {
+			tokenizer->continue_invalid_run();
+		}
+		reported = 0;
+	}
+
+  public:
+	/// Does not take ownership of `fd`
+	explicit StreamTokenizer(
+		int fd, usize window_size = WINDOW, Interner * interner = nullptr
+	)
+		: fd(fd), window(window_size), interner(interner) {
+		tokenizer.emplace(String(window.data(), 0));
+	}
+
+	StreamTokenizer(const StreamTokenizer &) = delete;
+	StreamTokenizer & operator=(const StreamTokenizer &) = delete;
+
+	Token next_token() {
+		while (true) {
+			Token token = tokenizer->next_token();
+			if (token.end + LOOKAHEAD <= filled or at_end) {
+				token.start += window_offset;
+				token.end += window_offset;
+				if (token.kind == TokenKind::identifier and
+					interner != nullptr) {
+					token.symbol = interner->intern(token.value);
+				}
+				auto const & errors = tokenizer->errors();
+				for (; reported < errors.size(); ++reported) {
+					LexicalError error = errors[reported];
+					error.offset += window_offset;
+					lexical_errors.push_back(error);
+				}
+				return token;
+			}
+			refill(token.start);
+		}
+	}
+
+	/// Lexical errors of the tokens returned so far
+	std::vector<LexicalError> const & errors() const {
+		return lexical_errors;
+	}
+
+	/// Whether reading stopped on an error rather than end of file
+	bool failed() const { return read_failed; }
+
+	/// Bytes held by the window
+	usize memory() const { return window.capacity(); }
+};
+
+}; // namespace syntax
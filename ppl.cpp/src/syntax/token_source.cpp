@@ -0,0 +1,203 @@
+#pragma once
+#include "token_stream.cpp"
+#include "tokenizer.cpp"
+#include <span>
+
+namespace syntax {
+
+/// Token sources of a BasicParser. Both skip comments and let the
+/// parser look one token past the current one, a run of new lines
+/// counting as a single token.
+
+/// Lexes the whole source into a TokenStream up front, tokens stay
+/// accessible by index after parsing
+struct TokenBuffer {
+  private:
+	TokenStream tokens;
+	usize cursor = 0;
+
+  public:
+	TokenBuffer(String source, Interner * interner) : tokens(source) {
+		Tokenizer tokenizer(source, interner);
+		Token batch[256];
+		usize count;
+		do {
+			count = tokenizer.next_tokens(batch);
+			usize kept = 0;
+			for (usize i = 0; i < count; ++i) {
+				if (batch[i].kind != TokenKind::comment) {
+					batch[kept++] = batch[i];
+				}
+			}
+			tokens.push(std::span(batch, kept));
+		} while (batch[count - 1].kind != TokenKind::eof);
+		tokens.push_errors(tokenizer.errors());
+	}
+
+	TokenKind kind() const { return tokens.kind(cursor); }
+
+	/// Kind of the token after the current one
+	TokenKind next_kind() const {
+		usize next = cursor + 1;
+		if (kind() == TokenKind::new_line) {
+			while (tokens.kind(next) == TokenKind::new_line) {
+				next += 1;
+			}
+		}
+		return tokens.kind(next);
+	}
+
+	usize start() const { return tokens.start(cursor); }
+
+	u32 symbol() const { return tokens.symbol(cursor); }
+
+	String value() const { return tokens[cursor].value; }
+
+	/// Moves to the next token, eof is never passed
+	void advance() {
+		if (kind() != TokenKind::eof) {
+			cursor += 1;
+		}
+	}
+
+	/// Tokens lexed, comments excluded
+	usize count() const { return tokens.size(); }
+
+	std::span<const LexicalError> errors() const { return tokens.errors(); }
+
+	TokenStream const & stream() const { return tokens; }
+};
+
+/// Tokens [first, last) of a TokenStream followed by an eof, for parts
+/// of a stream parsed on their own. Their lexical errors stay with the
+/// stream.
+struct TokenSlice {
+  private:
+	TokenStream const * tokens;
+	usize first;
+	usize last;
+	usize cursor;
+
+  public:
+	TokenSlice(TokenStream const & tokens, usize first, usize last)
+		: tokens(&tokens), first(first), last(last), cursor(first) {}
+
+	TokenKind kind() const {
+		return cursor < last ? tokens->kind(cursor) : TokenKind::eof;
+	}
+
+	/// Kind of the token after the current one
+	TokenKind next_kind() const {
+		usize next = cursor + 1;
+		if (kind() == TokenKind::new_line) {
+			while (next < last and tokens->kind(next) == TokenKind::new_line) {
+				next += 1;
+			}
+		}
+		return next < last ? tokens->kind(next) : TokenKind::eof;
+	}
+
+	/// The eof of a slice starts where the token after it does
+	usize start() const { return tokens->start(cursor); }
+
+	u32 symbol() const { return tokens->symbol(cursor); }
+
+	String value() const { return (*tokens)[cursor].value; }
+
+	/// Moves to the next token, eof is never passed
+	void advance() {
+		if (kind() != TokenKind::eof) {
+			cursor += 1;
+		}
+	}
+
+	usize count() const { return last - first; }
+
+	std::span<const LexicalError> errors() const { return {}; }
+};
+
+/// Pulls tokens from a Tokenizer as the parser moves, only the current
+/// token and the one after it are kept. Runs of new lines are folded
+/// into their first token as they are pulled.
+struct TokenRing {
+	/// The current token and the one after it
+	static constexpr usize CAPACITY = 2;
+
+  private:
+	Tokenizer tokenizer;
+	Token ring[CAPACITY];
+	/// Slot of the current token
+	usize head = 0;
+	/// Tokens in the ring, from head on
+	usize size = 0;
+	usize pulled = 0;
+
+	Token const & back() const {
+		return ring[(head + size - 1) % CAPACITY];
+	}
+
+	/// Lexes the next token that is neither a comment nor part of a run
+	/// of new lines into the ring
+	void pull() {
+		while (true) {
+			Token token = tokenizer.next_token();
+			if (token.kind == TokenKind::comment) {
+				continue;
+			}
+			pulled += 1;
+			if (token.kind == TokenKind::new_line and size > 0 and
+				back().kind == TokenKind::new_line) {
+				continue;
+			}
+			ring[(head + size) % CAPACITY] = token;
+			size += 1;
+			return;
+		}
+	}
+
+	void fill() {
+		while (size < CAPACITY and back().kind != TokenKind::eof) {
+			pull();
+		}
+	}
+
+  public:
+	TokenRing(String source, Interner * interner)
+		: tokenizer(source, interner) {
+		pull();
+		fill();
+	}
+
+	TokenKind kind() const { return ring[head].kind; }
+
+	/// Kind of the token after the current one
+	TokenKind next_kind() const {
+		return size > 1 ? ring[(head + 1) % CAPACITY].kind : TokenKind::eof;
+	}
+
+	usize start() const { return ring[head].start; }
+
+	u32 symbol() const { return ring[head].symbol; }
+
+	String value() const { return ring[head].value; }
+
+	/// Moves to the next token, eof is never passed
+	void advance() {
+		if (kind() != TokenKind::eof) {
+			head = (head + 1) % CAPACITY;
+			size -= 1;
+			fill();
+		}
+	}
+
+	/// Tokens lexed so far, comments excluded. All of them once the
+	/// parser reached eof.
+	usize count() const { return pulled; }
+
+	/// Lexical errors of the tokens lexed so far
+	std::span<const LexicalError> errors() const {
+		return tokenizer.errors();
+	}
+};
+
+}; // namespace syntax
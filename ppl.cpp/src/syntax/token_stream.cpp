@@ -0,0 +1,233 @@
+#pragma once
+#include "tokenizer.cpp"
+#include <algorithm>
+#include <span>
+#include <vector>
+
+namespace syntax {
+
+/// Tokens of a source stored as parallel arrays of kind, byte offset,
+/// byte length and symbol, 13 bytes per token instead of sizeof(Token).
+/// Token values are rebuilt from the source on access. Offsets are 32
+/// bits wide, sources are limited to 4 GiB.
+///
+/// Lexical errors are kept aside in source order, they are rare.
+struct TokenStream {
+  private:
+	String source;
+	std::vector<u8> kinds;
+	std::vector<u32> offsets;
+	std::vector<u32> lengths;
+	std::vector<u32> symbols;
+	std::vector<LexicalError> lexical_errors;
+
+	/// Resizes `array[first, last)` to `count` elements in place
+	template <typename T>
+	static void resize_range(
+		std::vector<T> & array, usize first, usize last, usize count
+	) {
+		usize size = last - first;
+		if (count > size) {
+			array.insert(array.begin() + (isize)last, count - size, T{});
+		} else {
+			array.erase(
+				array.begin() + (isize)(first + count),
+				array.begin() + (isize)last
+			);
+		}
+	}
+
+  public:
+	struct Iterator {
+		TokenStream const * stream;
+		usize index;
+
+		Token operator*() const { return (*stream)[index]; }
+
+		Iterator & operator++() {
+			index += 1;
+			return *this;
+		}
+
+		bool operator!=(Iterator const & rhs) const {
+			return index != rhs.index;
+		}
+	};
+
+	TokenStream(String source) : source(source) {}
+
+	/// Appends a token produced by a Tokenizer over the same source
+	void push(Token const & token) {
+		kinds.push_back((u8)token.kind);
+		offsets.push_back((u32)token.start);
+		lengths.push_back((u32)(token.end - token.start));
+		symbols.push_back(token.symbol);
+	}
+
+	/// Appends a batch of tokens, see Tokenizer::next_tokens. The arrays
+	/// grow once per batch instead of once per token.
+	void push(std::span<const Token> batch) {
+		usize size = kinds.size();
+		kinds.resize(size + batch.size());
+		offsets.resize(size + batch.size());
+		lengths.resize(size + batch.size());
+		symbols.resize(size + batch.size());
+
+		u8 * kind = kinds.data() + size;
+		u32 * offset = offsets.data() + size;
+		u32 * length = lengths.data() + size;
+		u32 * symbol = symbols.data() + size;
+		for (usize i = 0; i < batch.size(); ++i) {
+			kind[i] = (u8)batch[i].kind;
+			offset[i] = (u32)batch[i].start;
+			length[i] = (u32)(batch[i].end - batch[i].start);
+			symbol[i] = batch[i].symbol;
+		}
+	}
+
+	/// Appends lexical errors following the ones already in the stream
+	void push_errors(std::span<const LexicalError> errors) {
+		lexical_errors.insert(
+			lexical_errors.end(), errors.begin(), errors.end()
+		);
+	}
+
+	/// Appends the first `count` tokens of `other`, a stream over the
+	/// same source, and all its errors
+	void append(TokenStream const & other, usize count) {
+		push_errors(other.lexical_errors);
+		kinds.insert(
+			kinds.end(), other.kinds.begin(), other.kinds.begin() + count
+		);
+		offsets.insert(
+			offsets.end(), other.offsets.begin(), other.offsets.begin() + count
+		);
+		lengths.insert(
+			lengths.end(), other.lengths.begin(), other.lengths.begin() + count
+		);
+		symbols.insert(
+			symbols.end(), other.symbols.begin(), other.symbols.begin() + count
+		);
+	}
+
+	/// Replaces every symbol s by `remap[s]`, to move the stream from
+	/// one interner to another
+	void remap_symbols(std::span<const u32> remap) {
+		for (u32 & symbol : symbols) {
+			if (symbol != Interner::NO_SYMBOL) {
+				symbol = remap[symbol];
+			}
+		}
+	}
+
+	/// Replaces tokens [first, last) with `replacement` and moves the
+	/// offsets of the tokens after them by `shift`, `source` is the
+	/// edited source the stream now refers to. The errors inside the
+	/// replaced tokens are replaced by `errors`.
+	void splice(
+		String source,
+		usize first,
+		usize last,
+		std::span<const Token> replacement,
+		std::span<const LexicalError> errors,
+		isize shift
+	) {
+		// every error lies inside a token
+		auto error_at = [&](usize token) {
+			if (token == size()) {
+				return lexical_errors.end();
+			}
+			return std::lower_bound(
+				lexical_errors.begin(),
+				lexical_errors.end(),
+				(usize)offsets[token],
+				[](LexicalError const & error, usize offset) {
+					return error.offset < offset;
+				}
+			);
+		};
+		usize first_error = (usize)(error_at(first) - lexical_errors.begin());
+		usize last_error = (usize)(error_at(last) - lexical_errors.begin());
+		resize_range(lexical_errors, first_error, last_error, errors.size());
+		std::copy(
+			errors.begin(),
+			errors.end(),
+			lexical_errors.begin() + (isize)first_error
+		);
+		for (usize i = first_error + errors.size(); i < lexical_errors.size();
+			 ++i) {
+			lexical_errors[i].offset += (usize)shift;
+		}
+
+		this->source = source;
+		usize count = replacement.size();
+		resize_range(kinds, first, last, count);
+		resize_range(offsets, first, last, count);
+		resize_range(lengths, first, last, count);
+		resize_range(symbols, first, last, count);
+
+		for (usize i = 0; i < count; ++i) {
+			kinds[first + i] = (u8)replacement[i].kind;
+			offsets[first + i] = (u32)replacement[i].start;
+			lengths[first + i] =
+				(u32)(replacement[i].end - replacement[i].start);
+			symbols[first + i] = replacement[i].symbol;
+		}
+		// wraps around for negative shifts
+		u32 delta = (u32)shift;
+		for (usize i = first + count; i < offsets.size(); ++i) {
+			offsets[i] += delta;
+		}
+	}
+
+	void reserve(usize count) {
+		kinds.reserve(count);
+		offsets.reserve(count);
+		lengths.reserve(count);
+		symbols.reserve(count);
+	}
+
+	usize size() const { return kinds.size(); }
+
+	TokenKind kind(usize i) const { return (TokenKind)kinds[i]; }
+
+	usize start(usize i) const { return offsets[i]; }
+
+	u32 symbol(usize i) const { return symbols[i]; }
+
+	std::span<const LexicalError> errors() const { return lexical_errors; }
+
+	/// Index of the first token starting at or after `offset`
+	usize lower_bound(usize offset) const {
+		auto found =
+			std::lower_bound(offsets.begin(), offsets.end(), (u32)offset);
+		return (usize)(found - offsets.begin());
+	}
+
+	Token operator[](usize i) const {
+		usize offset = offsets[i];
+		usize end = offset + lengths[i];
+		return {
+			.kind = kind(i),
+			.value = source.substring(offset, end),
+			.start = offset,
+			.end = end,
+			.symbol = symbols[i]
+		};
+	}
+
+	/// Bytes held by the stream
+	usize memory() const {
+		return kinds.capacity() * sizeof(u8) +
+			   offsets.capacity() * sizeof(u32) +
+			   lengths.capacity() * sizeof(u32) +
+			   symbols.capacity() * sizeof(u32) +
+			   lexical_errors.capacity() * sizeof(LexicalError);
+	}
+
+	Iterator begin() const { return {.stream = this, .index = 0}; }
+
+	Iterator end() const { return {.stream = this, .index = size()}; }
+};
+
+}; // namespace syntax
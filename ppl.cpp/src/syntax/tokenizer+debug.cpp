@@ -1,4 +1,5 @@
 #pragma once
+#include "line_index.cpp"
 #include "tokenizer.cpp"
 #include <format>
 
@@ -227,3 +228,48 @@ template <> struct std::formatter<syntax::Token> {
 		);
 	}
 };
+
+template <> struct std::formatter<syntax::LexicalErrorCode> {
+	constexpr auto parse(std::format_parse_context & ctx) {
+		return ctx.begin();
+	}
+
+	auto format(
+		const syntax::LexicalErrorCode & code, std::format_context & ctx
+	) const {
+		string_view name;
+		switch (code) {
+		case syntax::LexicalErrorCode::invalid_utf8:
+			name = "invalid_utf8";
+			break;
+		case syntax::LexicalErrorCode::embedded_nul:
+			name = "embedded_nul";
+			break;
+		case syntax::LexicalErrorCode::unterminated_string:
+			name = "unterminated_string";
+			break;
+		case syntax::LexicalErrorCode::unexpected_character:
+			name = "unexpected_character";
+			break;
+		case syntax::LexicalErrorCode::invalid_number:
+			name = "invalid_number";
+			break;
+		}
+
+		return std::format_to(ctx.out(), "{}", name);
+	}
+};
+
+template <> struct std::formatter<syntax::LexicalError> {
+	constexpr auto parse(std::format_parse_context & ctx) {
+		return ctx.begin();
+	}
+
+	auto format(
+		const syntax::LexicalError & error, std::format_context & ctx
+	) const {
+		return std::format_to(
+			ctx.out(), "({}, offset: {})", error.code, error.offset
+		);
+	}
+};
@@ -1,7 +1,14 @@
 #pragma once
 #include "../common.cpp"
+#include "../simd.cpp"
+#include "../utf8.cpp"
+#include <algorithm>
+#include <array>
 #include <compare>
 #include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
 
 namespace syntax {
 
@@ -81,365 +88,839 @@ enum class TokenKind {
 
 u8 is_utf8(u8 c) { return c & 0x80; }
 
-String COMPACT_KEYWORDS = "ifcompfnandornot";
+/// Lexical class of a byte, selects the handler lexing a token that
+/// starts with it
+enum class CharClass : u8 {
+	other,
+	end, // nul
+	new_line,
+	digit,
+	letter,
+	binding, // @
+	single, // tokens made of exactly one character
+	minus,
+	slash,
+	greater,
+	less,
+	dot,
+	bar,
+	quote,
+
+	count
+};
+
+/// Flags describing which lexing loops accept a byte
+constexpr u8 CHAR_BLANK = 1 << 0;
+constexpr u8 CHAR_DIGIT = 1 << 1;
+constexpr u8 CHAR_HEX_DIGIT = 1 << 2;
+constexpr u8 CHAR_OCT_DIGIT = 1 << 3;
+constexpr u8 CHAR_BIN_DIGIT = 1 << 4;
+constexpr u8 CHAR_IDENTIFIER = 1 << 5;
+constexpr u8 CHAR_SEPARATOR = 1 << 6; // underscore in numbers
+
+struct CharInfo {
+	CharClass char_class;
+	u8 flags;
+	TokenKind single; // token kind of CharClass::single bytes
+};
+
+constexpr std::array<CharInfo, 256> CHARACTERS = [] {
+	std::array<CharInfo, 256> table;
+	for (CharInfo & info : table) {
+		info = {
+			.char_class = CharClass::other,
+			.flags = 0,
+			.single = TokenKind::invalid
+		};
+	}
+
+	for (u8 c = '0'; c <= '9'; ++c) {
+		table[c].char_class = CharClass::digit;
+		table[c].flags |= CHAR_DIGIT | CHAR_HEX_DIGIT | CHAR_IDENTIFIER;
+		if (c <= '7')
+			table[c].flags |= CHAR_OCT_DIGIT;
+		if (c <= '1')
+			table[c].flags |= CHAR_BIN_DIGIT;
+	}
+	for (u8 c = 'a'; c <= 'z'; ++c) {
+		table[c].char_class = CharClass::letter;
+		table[c].flags |= CHAR_IDENTIFIER;
+		table[c - 'a' + 'A'].char_class = CharClass::letter;
+		table[c - 'a' + 'A'].flags |= CHAR_IDENTIFIER;
+		if (c <= 'f') {
+			table[c].flags |= CHAR_HEX_DIGIT;
+			table[c - 'a' + 'A'].flags |= CHAR_HEX_DIGIT;
+		}
+	}
+	table[' '].flags |= CHAR_BLANK;
+	table['\t'].flags |= CHAR_BLANK;
+	table['\r'].flags |= CHAR_BLANK;
+	table['_'].flags |= CHAR_SEPARATOR;
+
+	table[0].char_class = CharClass::end;
+	table['\n'].char_class = CharClass::new_line;
+	table['@'].char_class = CharClass::binding;
+	table['-'].char_class = CharClass::minus;
+	table['/'].char_class = CharClass::slash;
+	table['>'].char_class = CharClass::greater;
+	table['<'].char_class = CharClass::less;
+	table['.'].char_class = CharClass::dot;
+	table['|'].char_class = CharClass::bar;
+	table['"'].char_class = CharClass::quote;
+
+	const std::pair<u8, TokenKind> singles[] = {
+		{'=', TokenKind::eq},
+		{'+', TokenKind::plus},
+		{'*', TokenKind::times},
+		{'%', TokenKind::mod},
+		{'^', TokenKind::exponent},
+		{'~', TokenKind::bnot},
+		{'(', TokenKind::lparen},
+		{')', TokenKind::rparen},
+		{'[', TokenKind::lbracket},
+		{']', TokenKind::rbracket},
+		{'{', TokenKind::lbrace},
+		{'}', TokenKind::rbrace},
+		{',', TokenKind::comma},
+		{'\\', TokenKind::backslash},
+		{'\'', TokenKind::appostrophe},
+		{':', TokenKind::colon},
+		{'$', TokenKind::positional},
+		{'?', TokenKind::propagate},
+		{'_', TokenKind::special},
+	};
+	for (auto [c, kind] : singles) {
+		table[c].char_class = CharClass::single;
+		table[c].single = kind;
+	}
+	return table;
+}();
+
+/// Table entry of a rune, every non ascii rune is CharClass::other
+constexpr CharInfo const & char_info(u32 rune) {
+	return CHARACTERS[rune < 0x80 ? rune : 0x80];
+}
+
+constexpr bool has_flags(u32 rune, u8 flags) {
+	return (char_info(rune).flags & flags) != 0;
+}
+
 struct Keyword {
 	TokenKind kind;
-	String string;
+	std::string_view string;
 };
 
-const Keyword KEYWORDS[] = {
-	{.kind = TokenKind::kword_if,
-	 .string = COMPACT_KEYWORDS.substring(0, 2)},
-	{.kind = TokenKind::kword_comp,
-	 .string = COMPACT_KEYWORDS.substring(2, 6)},
-	{.kind = TokenKind::kword_fn,
-	 .string = COMPACT_KEYWORDS.substring(6, 8)},
-	{.kind = TokenKind::kword_and,
-	 .string = COMPACT_KEYWORDS.substring(8, 11)},
-	{.kind = TokenKind::kword_or,
-	 .string = COMPACT_KEYWORDS.substring(11, 13)},
-	{.kind = TokenKind::kword_not,
-	 .string = COMPACT_KEYWORDS.substring(13, 16)}
+/// Reserved words, the lookup table below is generated from this list
+constexpr Keyword KEYWORDS[] = {
+	{.kind = TokenKind::kword_if, .string = "if"},
+	{.kind = TokenKind::kword_comp, .string = "comp"},
+	{.kind = TokenKind::kword_fn, .string = "fn"},
+	{.kind = TokenKind::kword_and, .string = "and"},
+	{.kind = TokenKind::kword_or, .string = "or"},
+	{.kind = TokenKind::kword_not, .string = "not"},
 };
 
-/// Line and column in original source
-struct Point {
-	usize line;
-	usize column;
+/// Hash key of a keyword candidate: its size and first and last
+/// bytes, plus the second byte when those alone do not tell every
+/// keyword apart
+constexpr u32 keyword_key(
+	usize size, u8 first, u8 second, u8 last, bool use_second
+) {
+	u32 key = (u32)first | (u32)last << 8 | (u32)size << 16;
+	if (use_second) {
+		key ^= (u32)second << 24;
+	}
+	return key;
+}
+
+/// Collision free table of KEYWORDS. The key bytes, the smallest table
+/// size and the multiplier giving every keyword its own slot are
+/// searched at compile time, adding a keyword regenerates the table.
+struct KeywordTable {
+	static constexpr usize MAX_BITS = 10;
+
+	bool use_second = false;
+	u32 seed = 0;
+	u32 shift = 0;
+	usize min_size = 0;
+	usize max_size = 0;
+	// index + 1 of the keyword in KEYWORDS, 0 for empty slots
+	std::array<u8, 1 << MAX_BITS> slots = {};
+
+	constexpr u32 slot(usize size, u8 first, u8 second, u8 last) const {
+		u32 key = keyword_key(size, first, second, last, use_second);
+		return key * seed >> shift;
+	}
+
+	TokenKind lookup(String const & identifier) const {
+		if (identifier.size < min_size or identifier.size > max_size) {
+			return TokenKind::identifier;
+		}
+		u8 index = slots[slot(
+			identifier.size,
+			identifier[0],
+			identifier[1],
+			identifier[identifier.size - 1]
+		)];
+		if (index == 0) {
+			return TokenKind::identifier;
+		}
+		Keyword const & keyword = KEYWORDS[index - 1];
+		if (identifier.size == keyword.string.size() and
+			memcmp(
+				identifier.data,
+				keyword.string.data(),
+				identifier.size
+			) == 0) {
+			return keyword.kind;
+		}
+		return TokenKind::identifier;
+	}
+
+	static constexpr KeywordTable generate() {
+		KeywordTable table;
+		table.min_size = KEYWORDS[0].string.size();
+		for (Keyword const & keyword : KEYWORDS) {
+			table.min_size =
+				std::min(table.min_size, keyword.string.size());
+			table.max_size =
+				std::max(table.max_size, keyword.string.size());
+		}
+		// the second byte is only read from identifiers of min_size
+		// or more
+		if (table.min_size < 2) {
+			return {};
+		}
+
+		// a key shared by two keywords can not be separated by any
+		// seed, start hashing the second byte too
+		table.seed = 1;
+		table.shift = 0;
+		table.use_second = table.collides();
+
+		for (u32 bits = 1; bits <= MAX_BITS; ++bits) {
+			if ((1u << bits) < std::size(KEYWORDS)) {
+				continue;
+			}
+			table.shift = 32 - bits;
+			for (u32 attempt = 1; attempt < 256; ++attempt) {
+				table.seed = attempt * 0x9E3779B1u;
+				if (not table.collides()) {
+					table.fill();
+					return table;
+				}
+			}
+		}
+		// no perfect hash found, checked by the static_assert below
+		return {};
+	}
+
+  private:
+	constexpr u32 keyword_slot(usize i) const {
+		std::string_view string = KEYWORDS[i].string;
+		return slot(
+			string.size(), (u8)string[0], (u8)string[1], (u8)string.back()
+		);
+	}
+
+	constexpr bool collides() const {
+		for (usize i = 0; i < std::size(KEYWORDS); ++i) {
+			for (usize j = 0; j < i; ++j) {
+				if (keyword_slot(i) == keyword_slot(j)) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
 
-	bool operator==(const Point &) const = default;
-	auto operator<=>(const Point &) const = default;
+	constexpr void fill() {
+		for (usize i = 0; i < std::size(KEYWORDS); ++i) {
+			slots[keyword_slot(i)] = (u8)(i + 1);
+		}
+	}
 };
 
+constexpr KeywordTable KEYWORD_TABLE = KeywordTable::generate();
+static_assert(
+	KEYWORD_TABLE.seed != 0,
+	"no perfect hash for KEYWORDS, add key bytes or raise MAX_BITS"
+);
+
+/// Tokens only carry byte offsets in the source, lines and columns are
+/// resolved through a LineIndex when needed
 struct Token {
 	TokenKind kind;
 	String value;
-	Point start;
-	Point end;
+	usize start;
+	usize end;
+	/// Interned identifier, NO_SYMBOL for other tokens or when the
+	/// tokenizer has no interner
+	u32 symbol = Interner::NO_SYMBOL;
 
 	bool operator==(const Token &) const = default;
 };
 
-struct Tokenizer {
+/// Bytes past the end of a token the tokenizer may read to decide where
+/// it ends, `1e+5` is only a float once the digit after the sign is
+/// seen. None of them is ever a new line.
+constexpr usize LOOKAHEAD = 3;
+
+enum class LexicalErrorCode : u8 {
+	/// Ill formed UTF-8, a run of bad bytes is reported once
+	invalid_utf8,
+	/// A 0 byte before the end of the source
+	embedded_nul,
+	/// String without its closing quote on the same line
+	unterminated_string,
+	/// Rune that starts no token
+	unexpected_character,
+	/// Number starting with `00`, other leading zeros are allowed
+	invalid_number,
+};
+
+/// Entry of the lexical error side table. The offending bytes are also
+/// covered by the token that holds them, an invalid token unless the
+/// error is inside a string or comment.
+struct LexicalError {
+	LexicalErrorCode code;
+	usize offset;
+
+	bool operator==(const LexicalError &) const = default;
+};
+
+/// How the tokenizer finds the end of its source
+enum class Bounds {
+	/// Any String view, every read is checked against the size
+	checked,
+	/// The source is followed by zero padding (a SourceFile), scans
+	/// stop on the 0 byte and only then compare against the size
+	sentinel,
+};
+
+template <Bounds bounds> struct BasicTokenizer {
 
   private:
 	const String source;
+	/// Identifiers are interned as they are lexed when set
+	Interner * const interner;
+	/// Offset of the next ill formed UTF-8 sequence at or after the
+	/// current token, runes before it are decoded without checks
+	usize valid_until;
+	/// Whether the byte before the source is ill formed, see
+	/// continue_invalid_run
+	bool invalid_before_source = false;
+	/// Errors in source order
+	std::vector<LexicalError> lexical_errors;
 	usize start_of_token = 0;
 	usize next_cursor = 0;
 	usize current_cursor = 0;
 	u32 current_rune = 0;
 	u32 next_rune = 0;
 
-	Point start = {.line = 0, .column = 0};
-	Point end = {.line = 0, .column = 0};
-
 	Token generate_token(TokenKind kind) const {
 		return {
 			.kind = kind,
 			.value = source.substring(start_of_token, current_cursor),
-			.start = start,
-			.end = end
+			.start = start_of_token,
+			.end = current_cursor
 		};
 	}
 
 	Token consume_multi_line_string() {
-		while (next_rune != '\n' and next_rune != 0) {
-			advance();
-		}
+		skip_line();
 		return generate_token(TokenKind::string_literal);
 	}
 
+	/// Escapes are kept as written, a backslash only stops the rune
+	/// after it from closing the string. See `unescape_string`.
 	Token consume_string() {
 		while (next_rune != '"') {
 			if (next_rune == '\n' or next_rune == 0) {
+				report(LexicalErrorCode::unterminated_string, start_of_token);
 				return generate_token(TokenKind::invalid);
 			}
 			advance();
+			if (current_rune == '\\' and next_rune != '\n' and
+				next_rune != 0) {
+				advance();
+			}
 		}
+		advance();
 		return generate_token(TokenKind::string_literal);
 	}
 
 	Token consume_comment() {
-		while (next_rune != '\n' and next_rune != 0) {
-			advance();
-		}
+		skip_line();
 		return generate_token(TokenKind::comment);
 	}
 
 	Token consume_number() {
 		if (current_rune == '0') {
-			advance();
-			switch (current_rune) {
+			switch (next_rune) {
 			case '0':
+				advance();
+				report(LexicalErrorCode::invalid_number, start_of_token);
 				return generate_token(TokenKind::invalid);
 			case 'x':
-				while (is_hex_digit(next_rune) or next_rune == '_') {
-					advance();
-				}
+				advance();
+				skip_while(CHAR_HEX_DIGIT | CHAR_SEPARATOR);
 				return generate_token(TokenKind::hex_literal);
 			case 'o':
-				while (is_oct_digit(next_rune) or next_rune == '_') {
-					advance();
-				}
+				advance();
+				skip_while(CHAR_OCT_DIGIT | CHAR_SEPARATOR);
 				return generate_token(TokenKind::oct_literal);
 			case 'b':
-				while (is_binary_digit(next_rune) or
-					   next_rune == '_') {
-					advance();
-				}
+				advance();
+				skip_while(CHAR_BIN_DIGIT | CHAR_SEPARATOR);
 				return generate_token(TokenKind::bin_literal);
 			}
 		}
 
-		while (is_digit(next_rune) or next_rune == '_') {
+		skip_while(CHAR_DIGIT | CHAR_SEPARATOR);
+		TokenKind kind = TokenKind::int_literal;
+
+		// a fraction needs a digit after the dot, `1.foo` and `1..2`
+		// stay integers
+		if (next_rune == '.' and has_flags(peek(0), CHAR_DIGIT)) {
 			advance();
+			skip_while(CHAR_DIGIT | CHAR_SEPARATOR);
+			kind = TokenKind::float_literal;
 		}
-
-		return generate_token(TokenKind::int_literal);
-	}
-
-	Token consume_identifier() {
-		while (is_digit(next_rune) or is_letter(next_rune)) {
+		if (next_rune == 'e' or next_rune == 'E') {
+			u8 sign = peek(0);
+			usize digit = sign == '+' or sign == '-' ? 1 : 0;
+			if (has_flags(peek(digit), CHAR_DIGIT)) {
+				advance();
+				if (digit == 1) {
+					advance();
+				}
+				skip_while(CHAR_DIGIT | CHAR_SEPARATOR);
+				kind = TokenKind::float_literal;
+			}
+		}
+		if (next_rune == 'i' and not has_flags(peek(0), CHAR_IDENTIFIER)) {
 			advance();
+			kind = TokenKind::imaginary_literal;
 		}
+		return generate_token(kind);
+	}
 
-		String identifier_string =
-			source.substring(start_of_token, current_cursor);
+	Token consume_identifier() {
+		skip_while(CHAR_IDENTIFIER);
 
-		for (Keyword keyword : KEYWORDS) {
-			if (identifier_string == keyword.string) {
-				return generate_token(keyword.kind);
-			}
+		Token token = generate_token(KEYWORD_TABLE.lookup(
+			source.substring(start_of_token, current_cursor)
+		));
+		if (token.kind == TokenKind::identifier and interner != nullptr) {
+			token.symbol = interner->intern(token.value);
 		}
-		return generate_token(TokenKind::identifier);
+		return token;
 	}
 
 	// TODO: consume bindings
 	// TODO: consume positionals
 
-	bool is_letter(u32 rune) const {
-		return (rune >= 'a' and rune <= 'z') or
-			   (rune >= 'A' and rune <= 'Z');
+	/// Consumes runes as long as they have any of the `flags`. Only
+	/// ascii bytes other than new line carry flags, so the run is
+	/// classified on raw bytes and consumed in one step.
+	void skip_while(u8 flags) {
+		if (not has_flags(next_rune, flags)) {
+			return;
+		}
+		// the 0 byte has no flags, the sentinel ends the run on its own
+		usize stop = next_cursor;
+		while (in_bounds(stop) and
+			   (CHARACTERS[source[stop]].flags & flags) != 0) {
+			stop += 1;
+		}
+		advance_to(stop);
 	}
 
-	bool is_digit(u32 rune) const {
-		return rune >= '0' and rune <= '9';
+	void skip_spaces() {
+		if (not has_flags(next_rune, CHAR_BLANK)) {
+			return;
+		}
+		advance_to(simd::KERNELS.skip_blanks(
+			source.data, next_cursor, source.size
+		));
 	}
 
-	bool is_hex_digit(u32 rune) const {
-		return (rune >= '0' and rune <= '9') or
-			   (rune >= 'a' and rune <= 'f') or
-			   (rune >= 'A' and rune <= 'F');
+	/// Consumes runes up to the end of the line, leaving the new line
+	/// as next rune
+	void skip_line() {
+		while (next_rune != '\n' and next_rune != 0) {
+			advance_to(simd::KERNELS.find_line_stop(
+				source.data, next_cursor, source.size
+			));
+		}
 	}
 
-	bool is_oct_digit(u32 rune) const {
-		return rune >= '0' and rune <= '7';
+	/// Consumes every rune before the byte at `stop` as if `advance`
+	/// was called once for each of them. `stop` must be the start of a
+	/// rune.
+	void advance_to(usize stop) {
+		// jump to the start of the last rune before `stop` and let
+		// advance consume it and load the one after. That rune is a well
+		// formed sequence at most 3 bytes back, or else the ill formed
+		// byte right before `stop`, so runs of stray continuation bytes
+		// are not walked back over.
+		if (stop > next_cursor) {
+			usize last = stop - 1;
+			usize lead = last;
+			while (lead > next_cursor and last - lead < 3 and
+				   utf8::is_continuation(source[lead])) {
+				lead -= 1;
+			}
+			if (lead != last and not utf8::is_continuation(source[lead]) and
+				utf8::sequence_length(source.data + lead, stop - lead) ==
+					stop - lead) {
+				last = lead;
+			}
+			next_cursor = last;
+			load_next_rune();
+		}
+		advance();
 	}
 
-	bool is_binary_digit(u32 rune) const {
-		return rune >= '0' and rune <= '1';
+	void advance() {
+		current_rune = next_rune;
+		current_cursor = next_cursor;
+		load_next_rune();
 	}
 
-	void skip_spaces() {
-		for (;;) {
-			switch (next_rune) {
-			case ' ':
-			case '\t':
-			case '\r':
-				advance();
+	/// Byte `ahead` positions after the next rune, 0 past the end. Never
+	/// reads further than LOOKAHEAD bytes past the end of a token.
+	u8 peek(usize ahead) const {
+		usize i = next_cursor + ahead;
+		return in_bounds(i) ? source[i] : 0;
+	}
+
+	/// Whether `i` may be read without comparing it to the size first
+	bool in_bounds(usize i) const {
+		if constexpr (bounds == Bounds::sentinel) {
+			return true;
+		} else {
+			return i < source.size;
+		}
+	}
+
+	void report(LexicalErrorCode code, usize offset) {
+		lexical_errors.push_back({.code = code, .offset = offset});
+	}
+
+	/// Whether the byte before `offset`, a rune start, is an ill formed
+	/// byte rather than the end of a well formed sequence. A lead byte
+	/// always starts a rune, looking back 3 bytes at most tells.
+	bool invalid_before(usize offset) const {
+		if (offset == 0) {
+			return invalid_before_source;
+		}
+		if (source[offset - 1] < 0x80) {
+			return false;
+		}
+		for (usize lead = offset - 1; offset - lead <= 4; --lead) {
+			if (not utf8::is_continuation(source[lead])) {
+				usize length = offset - lead;
+				return utf8::sequence_length(source.data + lead, length) !=
+					   length;
+			}
+			if (lead == 0) {
 				break;
-			default:
-				return;
 			}
 		}
+		return true;
 	}
 
-	void advance() {
-		current_rune = next_rune;
-		current_cursor = next_cursor;
-		if (next_cursor < source.size) {
-			if (is_utf8(source[next_cursor])) {
-				// TODO: handle utf8
-			} else if (source[next_cursor] == 0) {
-				// TODO: illegal state (store lexical errors)
-			} else {
-				next_rune = source[next_cursor];
-
-				if (current_rune == '\n') {
-					end.line += 1;
-					end.column = 0;
-				} else {
-					end.column += 1;
-				}
-				next_cursor += 1;
+	/// Reports the ill formed bytes before `end`, once per run of them,
+	/// and moves `valid_until` to the next one. Validation restarts
+	/// right after each bad byte, decode_checked also skips them one at
+	/// a time, so lexing stays linear however many there are.
+	///
+	/// A run is told from the bytes before it, not from what was lexed
+	/// before, so a tokenizer started at any rune start reports the
+	/// errors a whole source lex does.
+	void report_invalid_utf8(usize end) {
+		while (valid_until < end) {
+			if (not invalid_before(valid_until)) {
+				report(LexicalErrorCode::invalid_utf8, valid_until);
 			}
-		} else {
+			valid_until =
+				utf8::validate(source.data, valid_until + 1, source.size);
+		}
+	}
+
+	/// Decodes the rune at `next_cursor` into `next_rune` and moves
+	/// `next_cursor` past it. The end of the source, and any 0 byte,
+	/// leaves `next_rune` at 0 without moving, consume_end tells them
+	/// apart. Ill formed sequences decode to U+FFFD, they are reported
+	/// once their token is done.
+	void load_next_rune() {
+		if (not in_bounds(next_cursor)) {
 			next_rune = 0;
-			if (current_rune == '\n') {
-				end.line += 1;
-				end.column = 0;
-			} else if (current_rune != 0) {
-				end.column += 1;
-			}
+			return;
+		}
+		u8 byte = source[next_cursor];
+		if (not is_utf8(byte)) [[likely]] {
+			next_rune = byte;
+			next_cursor += byte != 0;
+			return;
 		}
+
+		usize length;
+		if (next_cursor < valid_until) {
+			next_rune = utf8::decode(source.data + next_cursor, length);
+		} else {
+			next_rune = utf8::decode_checked(
+				source.data + next_cursor, source.size - next_cursor, length
+			);
+		}
+		next_cursor += length;
 	}
 
   public:
-	Tokenizer(String source) : source(source) {
+	BasicTokenizer(String source, Interner * interner = nullptr)
+		requires(bounds == Bounds::checked)
+		: BasicTokenizer(source, interner, 0) {}
+
+	/// The file must outlive the tokenizer
+	BasicTokenizer(SourceFile const & file, Interner * interner = nullptr)
+		requires(bounds == Bounds::sentinel)
+		: BasicTokenizer(file.string(), interner, 0) {}
+
+  private:
+	BasicTokenizer(String source, Interner * interner, int)
+		: source(source), interner(interner),
+		  valid_until(utf8::validate(source.data, 0, source.size)) {
 		advance();
-		// resetting after first advancing
-		start = {.line = 0, .column = 0};
-		end = {.line = 0, .column = 0};
 	}
 
+  public:
+
 	Token next_token() {
 		skip_spaces();
 
 		this->start_of_token = this->current_cursor;
-		this->start = this->end;
 
 		advance();
 
-		if (current_rune == '\n') {
-			return generate_token(TokenKind::new_line);
+		Token token =
+			HANDLERS[(usize)char_info(current_rune).char_class](*this);
+		if (token.end > valid_until) [[unlikely]] {
+			report_invalid_utf8(token.end);
 		}
+		return token;
+	}
+
+	/// For a source cut out of a larger one right after an ill formed
+	/// byte: a run of them at the start continues that one and is not
+	/// reported again. Call before lexing.
+	void continue_invalid_run() { invalid_before_source = true; }
+
+	/// Whether the byte before `offset`, the start of a token lexed by
+	/// this tokenizer, is ill formed, see continue_invalid_run
+	bool ends_invalid_run(usize offset) const {
+		return invalid_before(offset);
+	}
+
+	/// Lexical errors of the tokens returned so far, in source order
+	std::vector<LexicalError> const & errors() const {
+		return lexical_errors;
+	}
+
+	/// Lexes tokens into `tokens` until it is full or the eof token is
+	/// written, returns the number of tokens written. Cheaper than a
+	/// `next_token` call per token, the scanning state stays local to
+	/// one loop.
+	usize next_tokens(std::span<Token> tokens) {
+		usize count = 0;
+		while (count < tokens.size()) {
+			Token token = next_token();
+			tokens[count] = token;
+			count += 1;
+			if (token.kind == TokenKind::eof) {
+				break;
+			}
+		}
+		return count;
+	}
 
-		if (is_digit(current_rune)) {
-			return consume_number();
+  private:
+	using Handler = Token (*)(BasicTokenizer &);
+
+	/// Handler of each CharClass, called with the first rune of the
+	/// token as current rune
+	static const std::array<Handler, (usize)CharClass::count> HANDLERS;
+
+	/// Plain function wrapping a consume method, the call inside is
+	/// direct so the method gets inlined into its table entry
+	template <Token (BasicTokenizer::*consume)()>
+	static Token dispatch(BasicTokenizer & tokenizer) {
+		return (tokenizer.*consume)();
+	}
+
+	Token consume_other() {
+		// bad bytes are reported as invalid_utf8 after the token
+		usize available = source.size - start_of_token;
+		if (utf8::sequence_length(source.data + start_of_token, available) !=
+			0) {
+			report(LexicalErrorCode::unexpected_character, start_of_token);
 		}
+		return generate_token(TokenKind::invalid);
+	}
 
-		if (is_letter(current_rune)) {
-			return consume_identifier();
+	/// The end of the source, or a 0 byte in it. A 0 byte is skipped as
+	/// an invalid token and lexing goes on after it.
+	Token consume_end() {
+		if (current_cursor == source.size) {
+			return generate_token(TokenKind::eof);
 		}
+		report(LexicalErrorCode::embedded_nul, current_cursor);
+		next_cursor = current_cursor + 1;
+		current_cursor = next_cursor;
+		load_next_rune();
+		return generate_token(TokenKind::invalid);
+	}
+
+	Token consume_new_line() {
+		return generate_token(TokenKind::new_line);
+	}
 
-		switch (current_rune) {
+	Token consume_single() {
+		return generate_token(char_info(current_rune).single);
+	}
+
+	Token consume_minus() {
+		if (next_rune == '>') {
+			advance();
+			return generate_token(TokenKind::arrow);
+		}
+		return generate_token(TokenKind::minus);
+	}
+
+	Token consume_slash() {
+		if (next_rune == '/') {
+			advance();
+			return consume_comment();
+		}
+		return generate_token(TokenKind::by);
+	}
+
+	Token consume_greater() {
+		switch (next_rune) {
 		case '=':
-			return generate_token(TokenKind::eq);
-		case '+':
-			return generate_token(TokenKind::plus);
-			break;
-		case '*':
-			return generate_token(TokenKind::times);
-			break;
-		case '%':
-			return generate_token(TokenKind::mod);
-			break;
-		case '^':
-			return generate_token(TokenKind::exponent);
-			break;
-		case '~':
-			return generate_token(TokenKind::bnot);
-			break;
-		case '(':
-			return generate_token(TokenKind::lparen);
-			break;
-		case ')':
-			return generate_token(TokenKind::rparen);
-			break;
-		case '[':
-			return generate_token(TokenKind::lbracket);
-			break;
-		case ']':
-			return generate_token(TokenKind::rbracket);
-			break;
-		case '{':
-			return generate_token(TokenKind::lbrace);
-			break;
-		case '}':
-			return generate_token(TokenKind::rbrace);
-			break;
-		case ',':
-			return generate_token(TokenKind::comma);
-			break;
-		case '\\':
-			return generate_token(TokenKind::backslash);
-			break;
-		case '\'':
-			return generate_token(TokenKind::appostrophe);
-			break;
-		case ':':
-			return generate_token(TokenKind::colon);
-			break;
-		case '@':
-			return consume_identifier();
-			return generate_token(TokenKind::binding);
-			break;
-		case '$':
-			return generate_token(TokenKind::positional);
-			break;
-		case '?':
-			return generate_token(TokenKind::propagate);
-		case '_':
-			return generate_token(TokenKind::special);
-			break;
-
-		// Multi-character possibilities
-		case '-':
-			if (next_rune == '>') {
-				advance();
-				return generate_token(TokenKind::arrow);
-			} else {
-				return generate_token(TokenKind::minus);
-			}
-			break;
-		case '/':
-			if (next_rune == '/') {
-				advance();
-				return consume_comment();
-			} else {
-				return generate_token(TokenKind::by);
-			}
-			break;
+			advance();
+			return generate_token(TokenKind::ge);
 		case '>':
-			if (next_rune == '=') {
-				advance();
-				return generate_token(TokenKind::ge);
-			} else {
-				return generate_token(TokenKind::gt);
-			}
-			break;
+			advance();
+			return generate_token(TokenKind::rshift);
+		default:
+			return generate_token(TokenKind::gt);
+		}
+	}
+
+	Token consume_less() {
+		switch (next_rune) {
+		case '=':
+			advance();
+			return generate_token(TokenKind::le);
 		case '<':
-			if (next_rune == '=') {
-				advance();
-				return generate_token(TokenKind::le);
-			} else {
-				return generate_token(TokenKind::lt);
-			}
-			break;
-		case '.':
-			if (next_rune == '&') {
-				advance();
-				return generate_token(TokenKind::band);
-			} else if (next_rune == '|') {
-				advance();
-				return generate_token(TokenKind::bor);
-			} else if (next_rune == '^') {
-				advance();
-				return generate_token(TokenKind::bxor);
-			} else {
-				return generate_token(TokenKind::dot);
-			}
+			advance();
+			return generate_token(TokenKind::lshift);
+		default:
+			return generate_token(TokenKind::lt);
+		}
+	}
+
+	Token consume_dot() {
+		switch (next_rune) {
+		case '&':
+			advance();
+			return generate_token(TokenKind::band);
 		case '|':
-			if (next_rune == '>') {
-				advance();
-				return generate_token(TokenKind::pipe);
-			} else {
-				return generate_token(TokenKind::bar);
-			}
-		case '"':
+			advance();
+			return generate_token(TokenKind::bor);
+		case '^':
+			advance();
+			return generate_token(TokenKind::bxor);
+		default:
+			return generate_token(TokenKind::dot);
+		}
+	}
+
+	Token consume_bar() {
+		if (next_rune == '>') {
+			advance();
+			return generate_token(TokenKind::pipe);
+		}
+		return generate_token(TokenKind::bar);
+	}
+
+	Token consume_quote() {
+		if (next_rune == '"') {
+			advance();
 			if (next_rune == '"') {
 				advance();
-				if (next_rune == '"') {
-					advance();
-					return consume_multi_line_string();
-				}
-				return generate_token(TokenKind::string_literal);
-			} else {
-				return consume_string();
+				return consume_multi_line_string();
 			}
+			return generate_token(TokenKind::string_literal);
 		}
-
-		return generate_token(TokenKind::eof);
+		return consume_string();
 	}
 };
+
+template <Bounds bounds>
+constinit const std::array<
+	typename BasicTokenizer<bounds>::Handler,
+	(usize)CharClass::count>
+	BasicTokenizer<bounds>::HANDLERS = [] {
+		std::array<Handler, (usize)CharClass::count> handlers;
+		handlers[(usize)CharClass::other] =
+			dispatch<&BasicTokenizer::consume_other>;
+		handlers[(usize)CharClass::end] =
+			dispatch<&BasicTokenizer::consume_end>;
+		handlers[(usize)CharClass::new_line] =
+			dispatch<&BasicTokenizer::consume_new_line>;
+		handlers[(usize)CharClass::digit] =
+			dispatch<&BasicTokenizer::consume_number>;
+		handlers[(usize)CharClass::letter] =
+			dispatch<&BasicTokenizer::consume_identifier>;
+		handlers[(usize)CharClass::binding] =
+			dispatch<&BasicTokenizer::consume_identifier>;
+		handlers[(usize)CharClass::single] =
+			dispatch<&BasicTokenizer::consume_single>;
+		handlers[(usize)CharClass::minus] =
+			dispatch<&BasicTokenizer::consume_minus>;
+		handlers[(usize)CharClass::slash] =
+			dispatch<&BasicTokenizer::consume_slash>;
+		handlers[(usize)CharClass::greater] =
+			dispatch<&BasicTokenizer::consume_greater>;
+		handlers[(usize)CharClass::less] =
+			dispatch<&BasicTokenizer::consume_less>;
+		handlers[(usize)CharClass::dot] =
+			dispatch<&BasicTokenizer::consume_dot>;
+		handlers[(usize)CharClass::bar] =
+			dispatch<&BasicTokenizer::consume_bar>;
+		handlers[(usize)CharClass::quote] =
+			dispatch<&BasicTokenizer::consume_quote>;
+		return handlers;
+	}();
+
+using Tokenizer = BasicTokenizer<Bounds::checked>;
+using SentinelTokenizer = BasicTokenizer<Bounds::sentinel>;
+
+/// Token starting at `offset` in `source`, lexed again. Tokens never
+/// span lines, only the rest of the line is looked at.
+Token token_at(String source, usize offset) {
+	usize end = offset;
+	while (end < source.size and source.data[end] != '\n') {
+		end += 1;
+	}
+	end = std::min(end + 1, source.size);
+	Token token = Tokenizer(source.substring(offset, end)).next_token();
+	token.start += offset;
+	token.end += offset;
+	return token;
+}
+
 }; // namespace syntax
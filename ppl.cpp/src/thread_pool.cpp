@@ -0,0 +1,102 @@
+#pragma once
+#include "common.cpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Fixed set of threads running the jobs handed to for_each. The
+/// calling thread takes part as worker 0, the pool threads are workers
+/// 1 to size() - 1.
+struct ThreadPool {
+  private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	/// Current batch, set under the mutex before `generation` moves
+	std::function<void(usize worker, usize index)> job;
+	usize count = 0;
+	std::atomic<usize> next = 0;
+	usize generation = 0;
+	/// Pool threads still draining the current batch
+	usize running = 0;
+	bool stopping = false;
+
+	/// Runs jobs of the current batch until none are left, jobs are
+	/// picked one at a time so uneven files balance out
+	void drain(usize worker) {
+		for (usize i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+			job(worker, i);
+		}
+	}
+
+	void work(usize worker) {
+		usize seen = 0;
+		while (true) {
+			{
+				std::unique_lock lock(mutex);
+				wake.wait(lock, [&] {
+					return stopping or generation != seen;
+				});
+				if (stopping) {
+					return;
+				}
+				seen = generation;
+			}
+			drain(worker);
+			std::lock_guard lock(mutex);
+			running -= 1;
+			if (running == 0) {
+				done.notify_one();
+			}
+		}
+	}
+
+  public:
+	explicit ThreadPool(usize threads) {
+		for (usize worker = 1; worker < std::max<usize>(1, threads);
+			 ++worker) {
+			workers.emplace_back(&ThreadPool::work, this, worker);
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto & worker : workers) {
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+
+	usize size() const { return workers.size() + 1; }
+
+	/// Calls `fn(worker, index)` for every index in [0, count) and
+	/// returns once all calls are done. Calls on the same worker never
+	/// overlap, per worker state can be indexed by `worker`.
+	void for_each(
+		usize count, std::function<void(usize worker, usize index)> fn
+	) {
+		{
+			std::lock_guard lock(mutex);
+			job = std::move(fn);
+			this->count = count;
+			next = 0;
+			running = workers.size();
+			generation += 1;
+		}
+		wake.notify_all();
+		drain(0);
+		std::unique_lock lock(mutex);
+		done.wait(lock, [&] { return running == 0; });
+	}
+};
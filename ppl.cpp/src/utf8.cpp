@@ -0,0 +1,345 @@
+#pragma once
+#include "common.cpp"
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PEOPL_UTF8_X86 1
+#endif
+
+/// UTF-8 validation and decoding.
+///
+/// Sources are validated once up front with `validate`, runes before
+/// the first invalid byte can then be decoded with `decode` without
+/// checking them again.
+namespace utf8 {
+
+constexpr u32 REPLACEMENT = 0xFFFD;
+
+bool is_continuation(u8 c) { return (c & 0xC0) == 0x80; }
+
+/// Length of the well formed sequence starting at `data[0]`, 0 if it
+/// is not well formed (overlong, surrogate, above U+10FFFF, truncated
+/// or a stray continuation byte)
+usize sequence_length(const u8 * data, usize available) {
+	u8 c = data[0];
+	if (c < 0x80) {
+		return 1;
+	}
+
+	usize length;
+	u8 low = 0x80;
+	u8 high = 0xBF;
+	if (c >= 0xC2 and c <= 0xDF) {
+		length = 2;
+	} else if (c >= 0xE0 and c <= 0xEF) {
+		length = 3;
+		if (c == 0xE0)
+			low = 0xA0; // overlong
+		if (c == 0xED)
+			high = 0x9F; // surrogates
+	} else if (c >= 0xF0 and c <= 0xF4) {
+		length = 4;
+		if (c == 0xF0)
+			low = 0x90; // overlong
+		if (c == 0xF4)
+			high = 0x8F; // above U+10FFFF
+	} else {
+		return 0;
+	}
+
+	if (available < length or data[1] < low or data[1] > high) {
+		return 0;
+	}
+	for (usize i = 2; i < length; ++i) {
+		if (not is_continuation(data[i])) {
+			return 0;
+		}
+	}
+	return length;
+}
+
+/// Decodes the rune starting at `data[0]`, which must be the start of
+/// a well formed sequence, and stores its length in `length`
+u32 decode(const u8 * data, usize & length) {
+	u8 c = data[0];
+	if (c < 0x80) {
+		length = 1;
+		return c;
+	}
+	if (c < 0xE0) {
+		length = 2;
+		return (u32)(c & 0x1F) << 6 | (u32)(data[1] & 0x3F);
+	}
+	if (c < 0xF0) {
+		length = 3;
+		return (u32)(c & 0x0F) << 12 | (u32)(data[1] & 0x3F) << 6 |
+			   (u32)(data[2] & 0x3F);
+	}
+	length = 4;
+	return (u32)(c & 0x07) << 18 | (u32)(data[1] & 0x3F) << 12 |
+		   (u32)(data[2] & 0x3F) << 6 | (u32)(data[3] & 0x3F);
+}
+
+/// Writes the encoding of `rune`, a scalar value, to `out` and returns
+/// its length
+usize encode(u32 rune, u8 * out) {
+	if (rune < 0x80) {
+		out[0] = (u8)rune;
+		return 1;
+	}
+	if (rune < 0x800) {
+		out[0] = (u8)(0xC0 | rune >> 6);
+		out[1] = (u8)(0x80 | (rune & 0x3F));
+		return 2;
+	}
+	if (rune < 0x10000) {
+		out[0] = (u8)(0xE0 | rune >> 12);
+		out[1] = (u8)(0x80 | (rune >> 6 & 0x3F));
+		out[2] = (u8)(0x80 | (rune & 0x3F));
+		return 3;
+	}
+	out[0] = (u8)(0xF0 | rune >> 18);
+	out[1] = (u8)(0x80 | (rune >> 12 & 0x3F));
+	out[2] = (u8)(0x80 | (rune >> 6 & 0x3F));
+	out[3] = (u8)(0x80 | (rune & 0x3F));
+	return 4;
+}
+
+/// Like `decode` for unvalidated input, an ill formed byte decodes to
+/// U+FFFD with length 1
+u32 decode_checked(const u8 * data, usize available, usize & length) {
+	if (sequence_length(data, available) == 0) {
+		length = 1;
+		return REPLACEMENT;
+	}
+	return decode(data, length);
+}
+
+/// Offset of the first ill formed sequence in `data[from, size)`,
+/// `size` if the whole range is valid. `from` must be the start of a
+/// sequence.
+usize validate_scalar(const u8 * data, usize from, usize size) {
+	while (from < size) {
+		// ascii fast path, eight bytes at a time
+		if (from + 8 <= size) {
+			u64 word;
+			memcpy(&word, data + from, 8);
+			if ((word & 0x8080808080808080ull) == 0) {
+				from += 8;
+				continue;
+			}
+		}
+		usize length = sequence_length(data + from, size - from);
+		if (length == 0) {
+			return from;
+		}
+		from += length;
+	}
+	return size;
+}
+
+#ifdef PEOPL_UTF8_X86
+
+// Error bits of the lookup algorithm, see "Validating UTF-8 In Less
+// Than One Instruction Per Byte" (Keiser, Lemire). Each table maps a
+// nibble of two consecutive bytes to the errors it may take part in,
+// an error is present when all three lookups agree on it.
+constexpr u8 TOO_SHORT = 1 << 0; // lead byte not followed by continuation
+constexpr u8 TOO_LONG = 1 << 1; // ascii followed by continuation
+constexpr u8 OVERLONG_3 = 1 << 2;
+constexpr u8 TOO_LARGE = 1 << 3;
+constexpr u8 SURROGATE = 1 << 4;
+constexpr u8 OVERLONG_2 = 1 << 5;
+constexpr u8 TOO_LARGE_1000 = 1 << 6;
+constexpr u8 OVERLONG_4 = 1 << 6;
+constexpr u8 TWO_CONTINUATIONS = 1 << 7;
+constexpr u8 CARRY = TOO_SHORT | TOO_LONG | TWO_CONTINUATIONS;
+
+/// Broadcasts a 16 entry table to both lanes for _mm256_shuffle_epi8
+__attribute__((target("avx2"))) __m256i table(const u8 (&entries)[16]) {
+	__m128i lane = _mm_loadu_si128((const __m128i *)entries);
+	return _mm256_broadcastsi128_si256(lane);
+}
+
+/// Bytes of `input` shifted by `n` positions, the first `n` coming
+/// from the end of `previous`
+template <int n>
+__attribute__((target("avx2"))) __m256i
+preceding(__m256i input, __m256i previous) {
+	return _mm256_alignr_epi8(
+		input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - n
+	);
+}
+
+__attribute__((target("avx2"))) usize
+validate_avx2(const u8 * data, usize from, usize size) {
+	static constexpr u8 byte_1_high[16] = {
+		TOO_LONG,
+		TOO_LONG,
+		TOO_LONG,
+		TOO_LONG,
+		TOO_LONG,
+		TOO_LONG,
+		TOO_LONG,
+		TOO_LONG,
+		TWO_CONTINUATIONS,
+		TWO_CONTINUATIONS,
+		TWO_CONTINUATIONS,
+		TWO_CONTINUATIONS,
+		TOO_SHORT | OVERLONG_2,
+		TOO_SHORT,
+		TOO_SHORT | OVERLONG_3 | SURROGATE,
+		TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+	};
+	static constexpr u8 byte_1_low[16] = {
+		CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+		CARRY | OVERLONG_2,
+		CARRY,
+		CARRY,
+		CARRY | TOO_LARGE,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+		CARRY | TOO_LARGE | TOO_LARGE_1000,
+	};
+	static constexpr u8 byte_2_high[16] = {
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 |
+			TOO_LARGE_1000 | OVERLONG_4,
+		TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | OVERLONG_3 |
+			TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE |
+			TOO_LARGE,
+		TOO_LONG | OVERLONG_2 | TWO_CONTINUATIONS | SURROGATE |
+			TOO_LARGE,
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_SHORT,
+		TOO_SHORT,
+	};
+	// a block ending in the middle of a sequence has a byte above
+	// these limits in its last three positions
+	static constexpr u8 incomplete_limits[32] = {
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+	};
+
+	const __m256i byte_1_high_table = table(byte_1_high);
+	const __m256i byte_1_low_table = table(byte_1_low);
+	const __m256i byte_2_high_table = table(byte_2_high);
+	const __m256i limits =
+		_mm256_loadu_si256((const __m256i *)incomplete_limits);
+	const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+
+	__m256i previous = _mm256_setzero_si256();
+	__m256i previous_incomplete = _mm256_setzero_si256();
+	usize block = from;
+
+	for (; block + 32 <= size; block += 32) {
+		__m256i input =
+			_mm256_loadu_si256((const __m256i *)(data + block));
+		__m256i error;
+
+		if (_mm256_movemask_epi8(input) == 0) {
+			// only an ascii block can't complete a sequence started in
+			// the previous one, other blocks check it against `previous`
+			error = previous_incomplete;
+			previous_incomplete = _mm256_setzero_si256();
+		} else {
+			__m256i previous_1 = preceding<1>(input, previous);
+			__m256i special_cases = _mm256_and_si256(
+				_mm256_and_si256(
+					_mm256_shuffle_epi8(
+						byte_1_high_table,
+						_mm256_and_si256(
+							_mm256_srli_epi16(previous_1, 4), low_nibble
+						)
+					),
+					_mm256_shuffle_epi8(
+						byte_1_low_table,
+						_mm256_and_si256(previous_1, low_nibble)
+					)
+				),
+				_mm256_shuffle_epi8(
+					byte_2_high_table,
+					_mm256_and_si256(
+						_mm256_srli_epi16(input, 4), low_nibble
+					)
+				)
+			);
+
+			// third and fourth bytes of a sequence must be
+			// continuations, only 111_____ and 1111____ leads end up
+			// with their high bit set
+			__m256i third_byte = _mm256_subs_epu8(
+				preceding<2>(input, previous), _mm256_set1_epi8(0x60)
+			);
+			__m256i fourth_byte = _mm256_subs_epu8(
+				preceding<3>(input, previous), _mm256_set1_epi8(0x70)
+			);
+			__m256i must_continue = _mm256_and_si256(
+				_mm256_or_si256(third_byte, fourth_byte),
+				_mm256_set1_epi8((char)0x80)
+			);
+
+			error = _mm256_xor_si256(must_continue, special_cases);
+			previous_incomplete = _mm256_subs_epu8(input, limits);
+		}
+		previous = input;
+
+		if (not _mm256_testz_si256(error, error)) {
+			break;
+		}
+	}
+
+	// locate the exact offset, and check the tail, with the scalar
+	// validator. Errors found in a block may start in the last three
+	// bytes before it, everything earlier is known to be well formed,
+	// so the scan restarts from the sequence covering those bytes.
+	if (block > from) {
+		usize boundary = block - std::min<usize>(3, block - from);
+		for (usize i = 0; i < 3 and boundary > from and
+						  is_continuation(data[boundary]);
+			 ++i) {
+			boundary -= 1;
+		}
+		block = boundary;
+	}
+	return validate_scalar(data, block, size);
+}
+
+#endif
+
+usize (*select_validate())(const u8 *, usize, usize) {
+#ifdef PEOPL_UTF8_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return validate_avx2;
+	}
+#endif
+	return validate_scalar;
+}
+
+/// Offset of the first ill formed sequence in `data[0, size)`, `size`
+/// if the whole range is valid
+usize (*const validate)(const u8 * data, usize from, usize size) =
+	select_validate();
+
+}; // namespace utf8
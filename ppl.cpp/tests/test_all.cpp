@@ -1,3 +1,14 @@
 #include "peopl.cpp"
+#include "test_source_file.cpp"
+#include "test_interner.cpp"
+#include "test_utf8.cpp"
+#include "test_literal.cpp"
 #include "test_tokenizer.cpp"
+#include "test_node_arena.cpp"
+#include "test_token_stream.cpp"
+#include "test_stream_tokenizer.cpp"
+#include "test_parallel_tokenizer.cpp"
+#include "test_relex.cpp"
+#include "test_line_index.cpp"
+#include "test_driver.cpp"
 #include "test_parser.cpp"
@@ -0,0 +1,99 @@
+#include "driver.cpp"
+#include "syntax/tokenizer+debug.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+TEST_CASE("thread pool runs every job once") {
+	for (usize threads : {1, 2, 5}) {
+		ThreadPool pool(threads);
+		REQUIRE(pool.size() == threads);
+		// the pool is reused across batches
+		for (usize count : {0, 1, 3, 1000}) {
+			std::vector<std::atomic<usize>> calls(count);
+			std::atomic<bool> bad_worker = false;
+			pool.for_each(count, [&](usize worker, usize index) {
+				if (worker >= threads) {
+					bad_worker = true;
+				}
+				calls[index] += 1;
+			});
+			REQUIRE(not bad_worker);
+			for (auto & call : calls) {
+				REQUIRE(call == 1);
+			}
+		}
+	}
+}
+
+TEST_CASE("project results do not depend on the thread count") {
+	namespace fs = std::filesystem;
+	char path[] = "/tmp/peopl_project_XXXXXX";
+	REQUIRE(mkdtemp(path) != nullptr);
+	fs::path root = path;
+	fs::create_directories(root / "nested" / "deeper");
+
+	std::vector<std::string> expected;
+	for (usize i = 0; i < 40; ++i) {
+		fs::path file = root / (i % 3 == 0 ? "nested" : "") /
+						(i % 5 == 0 ? "deeper" : "") /
+						std::format("file{}.ppl", i);
+		fs::create_directories(file.parent_path());
+		std::ofstream(file) << std::format(
+			"shared: value{} + {}\nlocal{}: \"text\" // comment\n{}",
+			i % 7,
+			i,
+			i,
+			i % 10 == 0 ? "bad é\n" : ""
+		);
+		expected.push_back(file.string());
+	}
+	std::ofstream(root / "notes.txt") << "not a source";
+	std::sort(expected.begin(), expected.end());
+
+	auto paths = driver::find_sources(root.string());
+	REQUIRE(paths.has_value());
+	REQUIRE(*paths == expected);
+
+	ThreadPool single(1);
+	driver::Project reference = driver::load_project(*paths, single);
+	REQUIRE(reference.files.size() == expected.size());
+	for (driver::FileResult const & file : reference.files) {
+		REQUIRE(file.loaded);
+		REQUIRE(file.tokens > 0);
+		REQUIRE(file.nodes > 0);
+	}
+	REQUIRE(reference.files[0].lexical_errors.size() == 1);
+	REQUIRE(
+		reference.files[0].error_points[0] ==
+		syntax::Point{.line = 2, .column = 4}
+	);
+
+	for (usize threads : {2, 3, 8}) {
+		ThreadPool pool(threads);
+		driver::Project project = driver::load_project(*paths, pool);
+		REQUIRE(project.files.size() == reference.files.size());
+		for (usize i = 0; i < project.files.size(); ++i) {
+			driver::FileResult const & file = project.files[i];
+			driver::FileResult const & other = reference.files[i];
+			REQUIRE(file.path == other.path);
+			REQUIRE(file.bytes == other.bytes);
+			REQUIRE(file.tokens == other.tokens);
+			REQUIRE(file.nodes == other.nodes);
+			REQUIRE(file.syntax_errors == other.syntax_errors);
+			REQUIRE(file.lexical_errors == other.lexical_errors);
+			REQUIRE(file.error_points == other.error_points);
+			REQUIRE(file.symbols == other.symbols);
+		}
+		REQUIRE(project.interner.size() == reference.interner.size());
+		for (u32 symbol = 0; symbol < project.interner.size(); ++symbol) {
+			REQUIRE(project.interner[symbol] == reference.interner[symbol]);
+		}
+	}
+
+	fs::remove_all(root);
+	REQUIRE(not driver::find_sources(root.string()).has_value());
+}
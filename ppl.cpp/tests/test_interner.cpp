@@ -0,0 +1,47 @@
+#include "common.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+TEST_CASE("arena") {
+	Arena arena;
+	u8 * first = arena.allocate(3);
+	u64 * aligned = (u64 *)arena.allocate(sizeof(u64), alignof(u64));
+	REQUIRE((uintptr_t)aligned % alignof(u64) == 0);
+	REQUIRE((u8 *)aligned >= first + 3);
+
+	// larger than a block
+	u8 * large = arena.allocate(3 * Arena::BLOCK);
+	memset(large, 1, 3 * Arena::BLOCK);
+	REQUIRE(arena.memory() >= 4 * Arena::BLOCK);
+
+	String copy = arena.copy("copied");
+	REQUIRE(copy == String("copied"));
+}
+
+TEST_CASE("interner") {
+	Interner interner;
+	REQUIRE(interner.intern("value") == 0);
+	REQUIRE(interner.intern("count") == 1);
+	REQUIRE(interner.intern("value") == 0);
+	REQUIRE(interner.intern("") == 2);
+	REQUIRE(interner.intern("") == 2);
+	REQUIRE(interner[1] == String("count"));
+
+	// symbols survive growth and their strings are owned copies
+	std::vector<std::string> names;
+	for (usize i = 0; i < 10000; ++i) {
+		names.push_back("identifier_" + std::to_string(i * 7919));
+	}
+	for (usize i = 0; i < names.size(); ++i) {
+		String name((const u8 *)names[i].data(), names[i].size());
+		REQUIRE(interner.intern(name) == 3 + i);
+	}
+	for (usize i = 0; i < names.size(); ++i) {
+		String name((const u8 *)names[i].data(), names[i].size());
+		REQUIRE(interner.intern(name) == 3 + i);
+		names[i][0] = 'X';
+		REQUIRE(interner[(u32)(3 + i)].data[0] == 'i');
+	}
+	REQUIRE(interner.size() == 3 + names.size());
+}
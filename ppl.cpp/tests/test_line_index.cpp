@@ -0,0 +1,42 @@
+#include "syntax/line_index.cpp"
+#include "syntax/tokenizer+debug.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <print>
+#include <string>
+
+TEST_CASE("line index points") {
+	String string =
+		" comp   if fnfn not \n   and  or    fn  compiffnnotandor";
+	syntax::LineIndex index(string);
+
+	REQUIRE(index.line_count() == 2);
+	REQUIRE(index.resolve(1) == syntax::Point{.line = 0, .column = 1});
+	REQUIRE(index.resolve(20) == syntax::Point{.line = 0, .column = 20});
+	REQUIRE(index.resolve(21) == syntax::Point{.line = 1, .column = 0});
+	REQUIRE(index.resolve(24) == syntax::Point{.line = 1, .column = 3});
+	REQUIRE(index.resolve(55) == syntax::Point{.line = 1, .column = 34});
+}
+
+TEST_CASE("line index matches a byte by byte count") {
+	std::string source;
+	for (usize i = 0; i < 200; ++i) {
+		source.append(i % 37, i % 3 == 0 ? '\t' : 'x');
+		source += '\n';
+		if (i % 11 == 0) {
+			source += "\n\n";
+		}
+	}
+	String string((const u8 *)source.data(), source.size());
+	syntax::LineIndex index(string);
+
+	syntax::Point point = {.line = 0, .column = 0};
+	for (usize offset = 0; offset <= string.size; ++offset) {
+		REQUIRE(index.resolve(offset) == point);
+		if (offset < string.size and string[offset] == '\n') {
+			point = {.line = point.line + 1, .column = 0};
+		} else {
+			point.column += 1;
+		}
+	}
+	REQUIRE(index.line_count() == point.line + 1);
+}
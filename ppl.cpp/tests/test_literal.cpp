@@ -0,0 +1,186 @@
+#include "syntax/literal.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <string>
+
+std::optional<u64> int_literal(const char * literal, u8 base) {
+	return syntax::int_from_string(String(literal), base);
+}
+
+TEST_CASE("int literal conversion") {
+	REQUIRE(int_literal("0", 10) == 0);
+	REQUIRE(int_literal("12_000", 10) == 12000);
+	REQUIRE(int_literal("1234567890123", 10) == 1234567890123);
+	REQUIRE(int_literal("0x1f_ff", 16) == 0x1fff);
+	REQUIRE(int_literal("0xDeadBeef_CAFE", 16) == 0xdeadbeefcafe);
+	REQUIRE(int_literal("0o1234_5670", 8) == 012345670);
+	REQUIRE(int_literal("0b1010_1010_1111_0000_1", 2) == 0b10101010111100001);
+
+	// u64 limits
+	REQUIRE(int_literal("18446744073709551615", 10) == ~0ull);
+	REQUIRE(int_literal("18_446_744_073_709_551_615", 10) == ~0ull);
+	REQUIRE(int_literal("18446744073709551616", 10) == std::nullopt);
+	REQUIRE(int_literal("99999999999999999999", 10) == std::nullopt);
+	REQUIRE(int_literal("0xffffffffffffffff", 16) == ~0ull);
+	REQUIRE(int_literal("0x1_0000_0000_0000_0000", 16) == std::nullopt);
+	REQUIRE(int_literal("0o1777777777777777777777", 8) == ~0ull);
+	REQUIRE(int_literal("0o2000000000000000000000", 8) == std::nullopt);
+	REQUIRE(int_literal(("0b" + std::string(64, '1')).c_str(), 2) == ~0ull);
+	REQUIRE(
+		int_literal(("0b1" + std::string(64, '0')).c_str(), 2) == std::nullopt
+	);
+	REQUIRE(int_literal("0000000000000000000000000000042", 10) == 42);
+
+	// prefix without digits
+	REQUIRE(int_literal("0x", 16) == std::nullopt);
+	REQUIRE(int_literal("0b__", 2) == std::nullopt);
+}
+
+TEST_CASE("int literal conversion matches the scalar reference") {
+	const char digits[] = "0123456789abcdefABCDEF";
+	const std::pair<u8, usize> bases[] = {{10, 10}, {16, 22}, {8, 8}, {2, 2}};
+	std::mt19937_64 random(11);
+	for (usize i = 0; i < 50000; ++i) {
+		auto [base, digit_count] = bases[i % 4];
+		std::string literal = base == 16  ? "0x"
+							  : base == 8 ? "0o"
+							  : base == 2 ? "0b"
+										  : "";
+		usize length = random() % 70;
+		for (usize d = 0; d < length; ++d) {
+			literal += random() % 10 == 0 ? '_' : digits[random() % digit_count];
+		}
+		String string(literal.c_str());
+		INFO(literal);
+		REQUIRE(
+			syntax::int_from_string(string, base) ==
+			syntax::int_from_string_scalar(string, base)
+		);
+	}
+}
+
+// strtod is the reference here, literals are parsed without it
+void require_strtod(std::string const & literal) {
+	f64 expected = strtod(literal.c_str(), nullptr);
+	f64 value = syntax::float_from_string(
+		String((const u8 *)literal.data(), literal.size())
+	);
+	INFO(literal);
+	REQUIRE(memcmp(&value, &expected, sizeof(f64)) == 0);
+}
+
+TEST_CASE("float literal conversion") {
+	const char * literals[] = {
+		"0.0",
+		"1.0",
+		"3.14",
+		"0.1",
+		"1e10",
+		"2.5e-3",
+		"1E+2",
+		"123456789012345678.0",
+		"9007199254740993.0", // 2^53 + 1, halfway
+		"9007199254740995.0",
+		"1e22",
+		"1e23",
+		"8.988465674311579e307",
+		"1.7976931348623157e308",
+		"1.7976931348623158e308", // rounds down to the maximum
+		"1.7976931348623159e308", // rounds up to infinity
+		"1e309",
+		"2.2250738585072011e-308", // largest subnormal
+		"2.2250738585072014e-308", // smallest normal
+		"4.9406564584124654e-324", // smallest subnormal
+		"2.4703282292062327e-324", // half of it, rounds to zero
+		"2.4703282292062328e-324", // just above half
+		"1e-400",
+		"0.000000000000000000000000000001",
+		"7.2057594037927933e16",
+		"2.2250738585072012e-308",
+		"4.35679296e-320",
+		"1.00000000000000011102230246251565404236316680908203125",
+		"1.00000000000000011102230246251565404236316680908203124",
+		"1.00000000000000011102230246251565404236316680908203126",
+		"9007199254740992.00000000000000000000000000000000001",
+		"0.00000000000000000000000000000000000000000000000000000001e56",
+	};
+	for (const char * literal : literals) {
+		require_strtod(literal);
+	}
+}
+
+TEST_CASE("float literal separators and suffix") {
+	auto convert = [](const char * literal) {
+		return syntax::float_from_string(
+			String((const u8 *)literal, strlen(literal))
+		);
+	};
+	REQUIRE(convert("1_000.000_5") == 1000.0005);
+	REQUIRE(convert("1e1_0") == 1e10);
+	REQUIRE(convert("2.5i") == 2.5);
+}
+
+TEST_CASE("float literal conversion matches strtod") {
+	std::mt19937_64 random(7);
+	for (usize i = 0; i < 20000; ++i) {
+		std::string literal;
+		usize digits = 1 + random() % (i % 4 == 0 ? 40 : 19);
+		for (usize d = 0; d < digits; ++d) {
+			literal += (char)('0' + random() % 10);
+		}
+		literal.insert(1 + random() % digits, ".");
+		if (literal.back() == '.') {
+			literal += '0';
+		}
+		literal += "e" + std::to_string((i64)(random() % 700) - 350);
+		require_strtod(literal);
+	}
+
+	// shortest representations of random doubles round trip
+	for (usize i = 0; i < 20000; ++i) {
+		u64 bits = random() & 0x7FEFFFFFFFFFFFFFull;
+		f64 value;
+		memcpy(&value, &bits, sizeof(value));
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%.17e", value);
+		require_strtod(buffer);
+	}
+}
+
+std::optional<std::string> unescape(const char * literal, Arena & arena) {
+	auto string = syntax::unescape_string(String(literal), arena);
+	if (not string) {
+		return std::nullopt;
+	}
+	return std::string((const char *)string->data, string->size);
+}
+
+TEST_CASE("string literal unescaping") {
+	Arena arena;
+	REQUIRE(unescape(R"("")", arena) == "");
+	REQUIRE(unescape(R"("a\tb\nc")", arena) == "a\tb\nc");
+	REQUIRE(unescape(R"("\"q\" \\ \'")", arena) == "\"q\" \\ '");
+	REQUIRE(unescape(R"("nul \0")", arena) == std::string("nul \0", 5));
+	REQUIRE(
+		unescape(R"("\u{41}\u{e9}\u{6F22}\u{1F680}")", arena) == "Aé漢🚀"
+	);
+	REQUIRE(unescape(R"(""" raw \n)", arena) == " raw \\n");
+
+	REQUIRE(unescape(R"("\q")", arena) == std::nullopt);
+	REQUIRE(unescape(R"("\u41")", arena) == std::nullopt);
+	REQUIRE(unescape(R"("\u{}")", arena) == std::nullopt);
+	REQUIRE(unescape(R"("\u{1234567}")", arena) == std::nullopt);
+	REQUIRE(unescape(R"("\u{D800}")", arena) == std::nullopt);
+	REQUIRE(unescape(R"("\u{110000}")", arena) == std::nullopt);
+	REQUIRE(unescape(R"("\u{41")", arena) == std::nullopt);
+}
+
+TEST_CASE("string literals without escapes are not copied") {
+	Arena arena;
+	String literal = "\"no escapes here\"";
+	auto string = syntax::unescape_string(literal, arena);
+	REQUIRE(string->data == literal.data + 1);
+	REQUIRE(arena.memory() == 0);
+}
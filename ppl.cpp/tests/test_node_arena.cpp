@@ -0,0 +1,49 @@
+#include "syntax/node_arena.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+namespace {
+
+struct Pair {
+	u64 first;
+	syntax::NodeId<Pair> next;
+};
+
+}; // namespace
+
+TEST_CASE("node arena handles survive growth") {
+	syntax::NodeArena arena;
+	std::vector<syntax::NodeId<Pair>> ids;
+	syntax::NodeId<Pair> previous;
+	REQUIRE(not previous.valid());
+
+	// well past a single commit step
+	usize count = 3 * syntax::NodeArena::COMMIT / sizeof(Pair);
+	for (usize i = 0; i < count; ++i) {
+		previous = arena.push(Pair{.first = i, .next = previous});
+		ids.push_back(previous);
+	}
+	REQUIRE(arena.memory() >= arena.size());
+	for (usize i = 0; i < count; ++i) {
+		REQUIRE(arena[ids[i]].first == i);
+		auto next = i == 0 ? syntax::NodeId<Pair>{} : ids[i - 1];
+		REQUIRE(arena[ids[i]].next == next);
+	}
+
+	// lists are contiguous copies, an empty one is fine
+	auto list = arena.push(std::span<const syntax::NodeId<Pair>>(ids));
+	auto empty = arena.push(std::span<const syntax::NodeId<Pair>>());
+	REQUIRE(arena[empty].empty());
+	auto span = arena[list];
+	REQUIRE(span.size() == ids.size());
+	REQUIRE(std::equal(span.begin(), span.end(), ids.begin()));
+
+	syntax::NodeArena moved = std::move(arena);
+	REQUIRE(moved[ids.back()].first == count - 1);
+
+	usize memory = moved.memory();
+	moved.clear();
+	REQUIRE(moved.size() == 0);
+	REQUIRE(moved.memory() == memory);
+	REQUIRE(moved[moved.push(Pair{.first = 7})].first == 7);
+}
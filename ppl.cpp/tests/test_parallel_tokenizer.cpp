@@ -0,0 +1,71 @@
+#include "syntax/parallel_tokenizer.cpp"
+#include "syntax/tokenizer+debug.cpp"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+syntax::TokenStream
+tokenize_sequential(String source, Interner * interner = nullptr) {
+	syntax::TokenStream tokens(source);
+	auto tokenizer = syntax::Tokenizer(source, interner);
+	syntax::Token token;
+	do {
+		token = tokenizer.next_token();
+		tokens.push(token);
+	} while (token.kind != syntax::TokenKind::eof);
+	tokens.push_errors(tokenizer.errors());
+	return tokens;
+}
+
+void require_same_tokens(
+	syntax::TokenStream const & tokens, syntax::TokenStream const & reference
+) {
+	REQUIRE(tokens.size() == reference.size());
+	for (usize i = 0; i < tokens.size(); ++i) {
+		REQUIRE(tokens[i] == reference[i]);
+	}
+	REQUIRE(std::ranges::equal(tokens.errors(), reference.errors()));
+}
+
+TEST_CASE("parallel tokenizer matches the sequential tokenizer") {
+	const char * lines[] = {
+		"x: 0x1f_ff + comp(y) // comment with é and ✓\n",
+		"   \"\"\" multi line string 漢字\n",
+		"\"unterminated string\n",
+		"pipeline |> fn .& 12_000 -> >= <=\n",
+		"\n",
+		"    \t\n",
+	};
+	std::string text;
+	for (usize i = 0; text.size() < 5 * syntax::MIN_CHUNK; ++i) {
+		text += lines[(i * 7) % std::size(lines)];
+	}
+	text += "tail without new line";
+	String source((const u8 *)text.data(), text.size());
+
+	auto reference = tokenize_sequential(source);
+	for (usize threads : {1, 2, 3, 4, 8}) {
+		require_same_tokens(
+			syntax::tokenize_parallel(source, threads), reference
+		);
+	}
+
+	// chunk interners merge into the same symbols
+	Interner reference_interner;
+	reference = tokenize_sequential(source, &reference_interner);
+	for (usize threads : {1, 3, 8}) {
+		Interner interner;
+		require_same_tokens(
+			syntax::tokenize_parallel(source, threads, &interner), reference
+		);
+		REQUIRE(interner.size() == reference_interner.size());
+	}
+
+	// 0 bytes are reported and skipped like any other lexical error
+	usize error_count = reference.errors().size();
+	text[text.size() / 3] = '\0';
+	text[text.size() / 2] = '\0';
+	reference = tokenize_sequential(source);
+	REQUIRE(reference.errors().size() >= error_count + 2);
+	require_same_tokens(syntax::tokenize_parallel(source, 4), reference);
+}
@@ -1,20 +1,437 @@
+#include "syntax/parser+debug.cpp"
 #include "syntax/parser.cpp"
 #include <catch2/catch_test_macros.hpp>
 #include <print>
 
+/// Trees of the top level expressions of `source`, one per entry
+std::vector<std::string> parse_trees(const char * source) {
+	syntax::Parser parser(source);
+	auto ast = parser.parse();
+	std::vector<std::string> trees;
+	for (auto expr : parser.get_expressions(ast.expression_list)) {
+		trees.push_back(syntax::format_tree(parser, expr));
+	}
+	return trees;
+}
+
 TEST_CASE("int literal") {
-	std::println("are we parsing this");
 	syntax::Parser parser("0x1_2, 0b_10, 5\n0o1234,   0xff, 1000");
-	for (auto token: parser.get_tokens()) {
-		std::println("token {}", token);
-	}
 	auto ast = parser.parse();
+	REQUIRE(parser.get_errors().empty());
+
+	u64 expected[] = {0x12, 0b10, 5, 01234, 0xff, 1000};
+	auto expressions = parser.get_expressions(ast.expression_list);
+	REQUIRE(expressions.size() == std::size(expected));
+	for (usize i = 0; i < std::size(expected); ++i) {
+		auto expression = parser.get_expression(expressions[i]);
+		REQUIRE(expression.kind == syntax::ExpressionKind::int_literal);
+		REQUIRE(expression.value.int_literal.value == expected[i]);
+	}
+}
+
+TEST_CASE("binary operators follow precedence") {
+	using Trees = std::vector<std::string>;
+	REQUIRE(parse_trees("1 + 2 * 3") == Trees{"(plus 1 (times 2 3))"});
+	REQUIRE(parse_trees("1 * 2 + 3") == Trees{"(plus (times 1 2) 3)"});
+	// same level operators fold to the left
+	REQUIRE(parse_trees("a - b - c") == Trees{"(minus (minus a b) c)"});
+	REQUIRE(
+		parse_trees("a ^ b ^ c") == Trees{"(exponent (exponent a b) c)"}
+	);
+	REQUIRE(
+		parse_trees("a or b and c = d .| e .^ f .& g << h + i * j ^ k") ==
+		Trees{"(kword_or a (kword_and b (eq c (bor d (bxor e (band f "
+			  "(lshift g (plus h (times i (exponent j k))))))))))"}
+	);
+	REQUIRE(
+		parse_trees("a ^ b * c + d >> e .& f .^ g .| h >= i and j or k") ==
+		Trees{"(kword_or (kword_and (ge (bor (bxor (band (rshift (plus "
+			  "(times (exponent a b) c) d) e) f) g) h) i) j) k)"}
+	);
+	REQUIRE(parse_trees("(1 + 2) * 3") == Trees{"(times (plus 1 2) 3)"});
+	REQUIRE(parse_trees("x % 2 / 3") == Trees{"(by (mod x 2) 3)"});
+	REQUIRE(parse_trees("a <= b") == Trees{"(le a b)"});
+}
+
+TEST_CASE("pipes, prefixes and postfixes") {
+	using Trees = std::vector<std::string>;
+	REQUIRE(
+		parse_trees("x + 1 |> f |> g") ==
+		Trees{"(pipe (pipe (plus x 1) f) g)"}
+	);
+	// a pipe starting a line continues the expression
+	REQUIRE(
+		parse_trees("x\n    |> f(1)\n    |> g\ny") ==
+		Trees{"(pipe (pipe x (call f 1)) g)", "y"}
+	);
+	REQUIRE(parse_trees("-a ^ b") == Trees{"(exponent (minus a) b)"});
+	REQUIRE(parse_trees("1 - -2") == Trees{"(minus 1 (minus 2))"});
+	REQUIRE(
+		parse_trees("not a and ~b") ==
+		Trees{"(kword_and (kword_not a) (bnot b))"}
+	);
+	REQUIRE(parse_trees("-a.b") == Trees{"(minus (access a b))"});
+	REQUIRE(
+		parse_trees("a.b(1, x: 2).c + f()") ==
+		Trees{
+			"(plus (access (call (access a b) 1 (tagged x 2)) c) (call f))"
+		}
+	);
+	REQUIRE(
+		parse_trees("f(\n  1,\n  2\n)") == Trees{"(call f 1 2)"}
+	);
+}
+
+TEST_CASE("definitions and comments") {
+	using Trees = std::vector<std::string>;
+	REQUIRE(
+		parse_trees(
+			"// header\n\nbasic: 42 // answer\n\nmath: 11 * 4 - 2\n"
+			"name: \"zuzmuz\"\nwell:\n"
+		) == Trees{
+				 "(tagged basic 42)",
+				 "(tagged math (minus (times 11 4) 2))",
+				 "(tagged name \"zuzmuz\")",
+				 "(tagged well)"
+			 }
+	);
+	REQUIRE(parse_trees("").empty());
+	REQUIRE(parse_trees("\n\n// only a comment\n").empty());
+	REQUIRE(parse_trees("1.5, 2i, 3e2") == Trees{"1.5", "2i", "3e2"});
+}
 
-	for (auto expr_idx : ast.expression_list.expr_list_idx) {
-		std::println(
-			"expression {}",
-			parser.get_expression(expr_idx)
+TEST_CASE("syntax errors are reported and skipped") {
+	using syntax::ErrorCode;
+	auto errors = [](const char * source) {
+		syntax::Parser parser(source);
+		parser.parse();
+		std::vector<ErrorCode> codes;
+		for (auto error : parser.get_errors()) {
+			codes.push_back(error.error_code);
+		}
+		return codes;
+	};
+	using Codes = std::vector<ErrorCode>;
+
+	REQUIRE(errors("a + , b") == Codes{ErrorCode::expected_expression});
+	REQUIRE(errors("(a + b") == Codes{ErrorCode::unclosed_parenthesis});
+	REQUIRE(errors("f(a, b") == Codes{ErrorCode::unclosed_parenthesis});
+	REQUIRE(
+		errors("a.1") ==
+		Codes{ErrorCode::expected_identifier, ErrorCode::unexpected_token}
+	);
+	REQUIRE(errors("a b c\nd") == Codes{ErrorCode::unexpected_token});
+	REQUIRE(errors("0x") == Codes{ErrorCode::invalid_int_literal});
+	REQUIRE(
+		parse_trees("a b\nc + * d\ne") ==
+		std::vector<std::string>{"a", "(plus c <invalid>)", "e"}
+	);
+}
+
+TEST_CASE("expression store round trips every kind") {
+	using namespace syntax;
+	ExpressionStore store;
+	Identifier name = {.offset = 3, .symbol = 9};
+
+	auto integer = store.push(make_int_literal(~0ull, 1));
+	auto number =
+		store.push(make_float_literal(ExpressionKind::float_literal, 2.5, 2));
+	auto imaginary = store.push(
+		make_float_literal(ExpressionKind::imaginary_literal, -1e300, 4)
+	);
+	auto string = store.push(make_string_literal(5));
+	auto identifier = store.push(make_identifier(name));
+	auto binary =
+		store.push(make_binary(TokenKind::pipe, integer, identifier));
+	auto tagged = store.push(make_tagged(name, binary));
+	auto invalid = store.push(make_invalid());
+	REQUIRE(store.size() == 8);
+
+	REQUIRE(store.kind(integer) == ExpressionKind::int_literal);
+	REQUIRE(store[integer].value.int_literal.value == ~0ull);
+	REQUIRE(store[integer].value.int_literal.offset == 1);
+	REQUIRE(store[number].kind == ExpressionKind::float_literal);
+	REQUIRE(store[number].value.float_literal.value == 2.5);
+	REQUIRE(store[imaginary].kind == ExpressionKind::imaginary_literal);
+	REQUIRE(store[imaginary].value.float_literal.value == -1e300);
+	REQUIRE(store[imaginary].value.float_literal.offset == 4);
+	REQUIRE(store[string].value.string_literal.offset == 5);
+	REQUIRE(store[identifier].value.identifier.symbol == 9);
+
+	REQUIRE(store.kind(binary) == ExpressionKind::binary);
+	REQUIRE(store.binary_op(binary) == TokenKind::pipe);
+	Binary decoded = store[binary].value.binary;
+	REQUIRE(decoded.op == TokenKind::pipe);
+	REQUIRE(decoded.lhs == integer);
+	REQUIRE(decoded.rhs == identifier);
+
+	Tagged tag = store[tagged].value.tagged;
+	REQUIRE(tag.expr == binary);
+	REQUIRE(tag.tag.offset == 3);
+	REQUIRE(tag.tag.symbol == 9);
+	REQUIRE(store.kind(invalid) == ExpressionKind::invalid);
+
+	NodeId<Expression> ids[] = {tagged, invalid};
+	auto list = store.list(store.push_list(ids));
+	REQUIRE(list.size() == 2);
+	REQUIRE(list[0] == tagged);
+	REQUIRE(list[1] == invalid);
+}
+
+/// Checks `parser` built the same nodes and reported the same errors
+/// as `expected`
+template <typename Tokens>
+void require_same_parse(
+	syntax::Parser const & expected,
+	syntax::SyntaxTree expected_ast,
+	syntax::BasicParser<Tokens> const & parser,
+	syntax::SyntaxTree ast
+) {
+	REQUIRE(parser.get_errors() == expected.get_errors());
+	REQUIRE(parser.get_token_count() == expected.get_token_count());
+	auto lexical_errors = parser.get_lexical_errors();
+	auto expected_lexical_errors = expected.get_lexical_errors();
+	REQUIRE(std::equal(
+		lexical_errors.begin(),
+		lexical_errors.end(),
+		expected_lexical_errors.begin(),
+		expected_lexical_errors.end()
+	));
+
+	auto const & expected_nodes = expected.get_nodes();
+	auto const & nodes = parser.get_nodes();
+	REQUIRE(nodes.size() == expected_nodes.size());
+	REQUIRE(nodes.memory() == expected_nodes.memory());
+	for (u32 i = 0; i < nodes.size(); ++i) {
+		syntax::NodeId<syntax::Expression> id = {.offset = i};
+		REQUIRE(nodes.tag(id) == expected_nodes.tag(id));
+		REQUIRE(nodes.payload(id).first == expected_nodes.payload(id).first);
+		REQUIRE(
+			nodes.payload(id).second == expected_nodes.payload(id).second
 		);
 	}
-	// std::println("{}", ast.tokens);
+	auto top = parser.get_expressions(ast.expression_list);
+	auto expected_top =
+		expected.get_expressions(expected_ast.expression_list);
+	REQUIRE(std::equal(
+		top.begin(), top.end(), expected_top.begin(), expected_top.end()
+	));
+}
+
+/// Parses `source` with both token sources in both modes and checks
+/// they all agree with the recursive Parser
+void require_same_modes(std::string const & source) {
+	using syntax::ParseMode;
+	INFO(source);
+	syntax::Parser expected(source.c_str());
+	auto expected_ast = expected.parse(ParseMode::recursive);
+
+	syntax::Parser stack(source.c_str());
+	auto stack_ast = stack.parse(ParseMode::explicit_stack);
+	require_same_parse(expected, expected_ast, stack, stack_ast);
+
+	for (ParseMode mode : {ParseMode::recursive, ParseMode::explicit_stack}) {
+		syntax::StreamingParser streaming(source.c_str());
+		auto streaming_ast = streaming.parse(mode);
+		require_same_parse(expected, expected_ast, streaming, streaming_ast);
+	}
+}
+
+TEST_CASE("explicit stack mode builds the same nodes") {
+	const char * sources[] = {
+		"0x1_2, 0b_10, 5\n0o1234,   0xff, 1000",
+		"a or b and c = d .| e .^ f .& g << h + i * j ^ k",
+		"a ^ b * c + d >> e .& f .^ g .| h >= i and j or k",
+		"x\n    |> f(1)\n    |> g\ny",
+		"-a ^ b, 1 - -2, not a and ~b, -a.b",
+		"a.b(1, x: 2).c + f()",
+		"f(\n  1,\n  2\n)",
+		"basic: 42\nmath: 11 * 4 - 2\nname: \"zuzmuz\"\nwell:\n",
+		"(a: (b: -(c)), f(g(h(1)))(2).x)",
+		"a + , b",
+		"(a + b",
+		"f(a, b",
+		"a.1",
+		"a b c\nd",
+		"0x",
+		"a b\nc + * d\ne",
+		"((a b) c d",
+		"f(x: , y:)",
+		")",
+		"",
+		// runs of new lines and comments are skipped by the token ring
+		"x\n\n// c\n\n   |> f\n\n|> g\n\n\ny",
+		"a // c\n\n: b\nt:\n\n\nu",
+		"\"a\\n\" + \"\xff\" $ 0x 01",
+		"f(\n\n)\n\n",
+	};
+	for (const char * source : sources) {
+		require_same_modes(source);
+	}
+
+	// random token soup, mostly malformed
+	const char * pieces[] = {"a",  "1",  "(", ")",  ",",  "\n", "+", "-",
+							 "*",  "^",  ".", "b:", "|>", "not", "2.5",
+							 "\"s\"", "f(", "=", "~", " ", "// c\n"};
+	u64 state = 7;
+	for (usize round = 0; round < 200; ++round) {
+		std::string source;
+		for (usize i = 0; i < 60; ++i) {
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			source += pieces[(state >> 33) % std::size(pieces)];
+			source += ' ';
+		}
+		require_same_modes(source);
+	}
+}
+
+TEST_CASE("explicit stack mode parses a million nesting levels") {
+	constexpr usize DEPTH = 1'000'000;
+	// every level nests through a different rule
+	const char * opens[] = {"(", "-", "f(", "a |> (", "t: (", "not "};
+	const char * closes[] = {")", "", ")", ")", ")", ""};
+	std::string source;
+	for (usize level = 0; level < DEPTH; ++level) {
+		source += opens[level % std::size(opens)];
+	}
+	source += "x";
+	for (usize level = DEPTH; level-- > 0;) {
+		source += closes[level % std::size(closes)];
+	}
+
+	syntax::Parser parser(source.c_str());
+	auto ast = parser.parse(syntax::ParseMode::explicit_stack);
+	REQUIRE(parser.get_errors().empty());
+	auto top = parser.get_expressions(ast.expression_list);
+	REQUIRE(top.size() == 1);
+
+	// walks down to x, parentheses add no node
+	using syntax::ExpressionKind;
+	auto const & nodes = parser.get_nodes();
+	syntax::NodeId<syntax::Expression> id = top[0];
+	usize levels = 0;
+	while (nodes.kind(id) != ExpressionKind::identifier) {
+		auto expression = parser.get_expression(id);
+		switch (expression.kind) {
+		case ExpressionKind::unary:
+			id = expression.value.unary.operand;
+			break;
+		case ExpressionKind::call:
+			REQUIRE(parser.get_expressions(expression.value.call.arguments)
+						.size() == 1);
+			id = parser.get_expressions(expression.value.call.arguments)[0];
+			break;
+		case ExpressionKind::binary:
+			id = expression.value.binary.rhs;
+			break;
+		case ExpressionKind::tagged:
+			id = expression.value.tagged.expr;
+			break;
+		default:
+			FAIL("unexpected " << (int)expression.kind);
+		}
+		levels += 1;
+	}
+	// every level but the plain parentheses is a node
+	REQUIRE(levels == DEPTH - DEPTH / 6 - (DEPTH % 6 > 0));
+	REQUIRE(
+		parser.get_text(nodes.payload(id).first) ==
+		String((const u8 *)"x", 1)
+	);
+}
+
+TEST_CASE("streaming parser reads leaves from the source") {
+	syntax::StreamingParser parser("name: \"a\\tb\" // comment\nx.y");
+	auto ast = parser.parse();
+	REQUIRE(parser.get_errors().empty());
+	auto top = parser.get_expressions(ast.expression_list);
+	REQUIRE(top.size() == 2);
+	REQUIRE(syntax::format_tree(parser, top[0]) == "(tagged name \"a\\tb\")");
+	REQUIRE(syntax::format_tree(parser, top[1]) == "(access x y)");
+
+	auto tagged = parser.get_expression(top[0]).value.tagged;
+	REQUIRE(tagged.tag.offset == 0);
+	auto literal = parser.get_expression(tagged.expr).value.string_literal;
+	REQUIRE(literal.offset == 6);
+	REQUIRE(parser.get_string(literal) == String((const u8 *)"a\tb", 3));
+	// name, colon, string, new line, x, dot, y and eof
+	REQUIRE(parser.get_token_count() == 8);
+}
+
+TEST_CASE("top level splits stop at whole expressions") {
+	syntax::Parser parser("a: 1\nb: (1,\n2)\nc: x +\ny\n|> f, d");
+	// not inside parentheses, after an operator or before a pipe
+	REQUIRE(
+		syntax::top_level_splits(parser.get_tokens(), 100) ==
+		std::vector<usize>{0, 4, 13, 23, 24}
+	);
+	REQUIRE(
+		syntax::top_level_splits(parser.get_tokens(), 1) ==
+		std::vector<usize>{0, 24}
+	);
+}
+
+TEST_CASE("parallel parse builds the same trees") {
+	// # is replaced by the definition number
+	const char * definitions[] = {
+		"d#: # + x * (y\n - z)\n",
+		"p#: a\n  |> f(1,\n 2)\n\n  |> g\n",
+		"e#: (a b\n c) d\n",
+		"o#: a +\n b, t#: -\n",
+		"// comment #\n\n",
+		"bad ) #\n",
+		"s#: \"str\" . #\n",
+		"c#: f(x: #, g(h).i)\n",
+	};
+	std::string source;
+	u64 state = 11;
+	for (usize i = 0; i < 3000; ++i) {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		for (const char * c =
+				 definitions[(state >> 33) % std::size(definitions)];
+			 *c != 0;
+			 ++c) {
+			if (*c == '#') {
+				source += std::to_string(i);
+			} else {
+				source += *c;
+			}
+		}
+	}
+	source += "unclosed: (a,\nb";
+
+	syntax::Parser expected(source.c_str());
+	auto expected_ast = expected.parse();
+	REQUIRE(not expected.get_errors().empty());
+	auto expected_top =
+		expected.get_expressions(expected_ast.expression_list);
+	REQUIRE(syntax::top_level_splits(expected.get_tokens(), 16).size() > 8);
+
+	for (usize threads = 1; threads <= 4; ++threads) {
+		for (auto mode :
+			 {syntax::ParseMode::recursive, syntax::ParseMode::explicit_stack}
+		) {
+			ThreadPool pool(threads);
+			syntax::Parser parser(source.c_str());
+			auto ast = parser.parse(pool, mode);
+			REQUIRE(parser.get_errors() == expected.get_errors());
+
+			auto const & nodes = parser.get_nodes();
+			REQUIRE(nodes.size() == expected.get_nodes().size());
+			for (u32 i = 0; i < nodes.size(); ++i) {
+				syntax::NodeId<syntax::Expression> id = {.offset = i};
+				REQUIRE(nodes.tag(id) == expected.get_nodes().tag(id));
+			}
+			auto top = parser.get_expressions(ast.expression_list);
+			REQUIRE(std::equal(
+				top.begin(), top.end(), expected_top.begin(), expected_top.end()
+			));
+			for (auto id : top) {
+				REQUIRE(
+					syntax::format_tree(parser, id) ==
+					syntax::format_tree(expected, id)
+				);
+			}
+		}
+	}
 }
@@ -0,0 +1,150 @@
+#include "syntax/relex.cpp"
+#include "syntax/tokenizer+debug.cpp"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+syntax::TokenStream tokenize_all(String source, Interner * interner) {
+	syntax::TokenStream tokens(source);
+	auto tokenizer = syntax::Tokenizer(source, interner);
+	syntax::Token token;
+	do {
+		token = tokenizer.next_token();
+		tokens.push(token);
+	} while (token.kind != syntax::TokenKind::eof);
+	tokens.push_errors(tokenizer.errors());
+	return tokens;
+}
+
+TEST_CASE("relex matches a full tokenization after edits") {
+	std::string text = "x: 0x1f_ff + comp(y) // comment é\n"
+					   "\n"
+					   "   \"\"\" multi line ✓\n"
+					   "pipeline |> fn .& 12_000 -> >= <=\n"
+					   "\"string\" and 'a'";
+	const char * insertions[] = {
+		"",	 "a",  "\n", "\"", "//", "\"\"\"", "0", "é",
+		" ", "\n\n", "->", "x\ny", "\0"
+	};
+
+	String source((const u8 *)text.data(), text.size());
+	// symbols stay comparable as long as one interner is shared
+	Interner interner;
+	syntax::TokenStream tokens = tokenize_all(source, &interner);
+
+	u64 state = 7;
+	auto random = [&](usize bound) {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return (usize)(state >> 33) % bound;
+	};
+
+	for (usize round = 0; round < 2000; ++round) {
+		// edit at a rune boundary so the text stays valid utf8
+		usize offset = random(text.size() + 1);
+		while (offset < text.size() and (text[offset] & 0xC0) == 0x80) {
+			offset += 1;
+		}
+		usize removed = random(std::min<usize>(4, text.size() - offset + 1));
+		while (offset + removed < text.size() and
+			   (text[offset + removed] & 0xC0) == 0x80) {
+			removed += 1;
+		}
+		usize choice = random(std::size(insertions));
+		// "\0" is a one byte string, the rest are c strings
+		std::string inserted = choice == std::size(insertions) - 1
+								   ? std::string(1, '\0')
+								   : std::string(insertions[choice]);
+		if (text.size() > 400) {
+			inserted.clear();
+			removed = std::min<usize>(20, text.size() - offset);
+		}
+
+		text.replace(offset, removed, inserted);
+		source = String((const u8 *)text.data(), text.size());
+		syntax::relex(
+			tokens,
+			source,
+			{.offset = offset, .removed = removed, .inserted = inserted.size()},
+			&interner
+		);
+
+		auto reference = tokenize_all(source, &interner);
+		REQUIRE(tokens.size() == reference.size());
+		for (usize i = 0; i < tokens.size(); ++i) {
+			REQUIRE(tokens[i] == reference[i]);
+		}
+		REQUIRE(std::ranges::equal(tokens.errors(), reference.errors()));
+	}
+}
+
+/// Applies `edit` to `text`, relexes `tokens` and compares them and
+/// their errors to a full tokenization
+void require_relex(
+	syntax::TokenStream & tokens,
+	std::string & text,
+	usize offset,
+	usize removed,
+	std::string const & inserted,
+	Interner * interner
+) {
+	text.replace(offset, removed, inserted);
+	String source((const u8 *)text.data(), text.size());
+	syntax::relex(
+		tokens,
+		source,
+		{.offset = offset, .removed = removed, .inserted = inserted.size()},
+		interner
+	);
+
+	auto reference = tokenize_all(source, interner);
+	REQUIRE(tokens.size() == reference.size());
+	for (usize i = 0; i < tokens.size(); ++i) {
+		REQUIRE(tokens[i] == reference[i]);
+	}
+	REQUIRE(std::ranges::equal(tokens.errors(), reference.errors()));
+}
+
+TEST_CASE("relex reports invalid utf8 runs like a full tokenization") {
+	Interner interner;
+
+	// the run starting at 0 loses its first byte
+	std::string text = "\xC3\xFF\x80";
+	auto tokens = tokenize_all(String((const u8 *)text.data(), 3), &interner);
+	require_relex(tokens, text, 0, 1, "\n", &interner);
+	REQUIRE(tokens.errors().size() == 1);
+	REQUIRE(tokens.errors()[0].offset == 1);
+
+	// a new line splits the run of a line that is relexed on its own
+	text = "a\n+\xC3\xC3";
+	tokens = tokenize_all(String((const u8 *)text.data(), 5), &interner);
+	require_relex(tokens, text, 4, 0, "\n", &interner);
+	REQUIRE(tokens.errors().size() == 2);
+	REQUIRE(tokens.errors()[1].offset == 5);
+
+	text = "x: \"é\" + 12\n// ✓ \xC3\n\"\"\" \xFF\x80\nfn(y) \xE2\x9C\n";
+	const char * insertions[] = {
+		"\xFF", "\x80", "\xC3", "\xE2\x9C", "\xF0\x9F\x9A", "é", "\n",
+		"\"", " ", "//", "a"
+	};
+	tokens = tokenize_all(
+		String((const u8 *)text.data(), text.size()), &interner
+	);
+
+	u64 state = 11;
+	auto random = [&](usize bound) {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return (usize)(state >> 33) % bound;
+	};
+
+	// edits land anywhere, splitting runes and runs of bad bytes
+	for (usize round = 0; round < 4000; ++round) {
+		usize offset = random(text.size() + 1);
+		usize removed = random(std::min<usize>(3, text.size() - offset + 1));
+		std::string inserted = insertions[random(std::size(insertions))];
+		if (text.size() > 200) {
+			inserted.clear();
+			removed = std::min<usize>(10, text.size() - offset);
+		}
+		require_relex(tokens, text, offset, removed, inserted, &interner);
+	}
+}
@@ -0,0 +1,74 @@
+#include "common.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <sys/wait.h>
+
+void require_padding(String string) {
+	for (usize i = 0; i < SourceFile::PADDING; ++i) {
+		REQUIRE(string.data[string.size + i] == 0);
+	}
+}
+
+TEST_CASE("source file padding") {
+	usize page = (usize)sysconf(_SC_PAGESIZE);
+
+	// sizes ending mid page, right before a page end and on it
+	for (usize size : {1ul, 100ul, page - 10, page, 2 * page}) {
+		std::string content;
+		for (usize i = 0; i < size; ++i) {
+			content += (char)('a' + i % 26);
+		}
+
+		char path[] = "/tmp/peopl_source_XXXXXX";
+		int fd = mkstemp(path);
+		REQUIRE(fd >= 0);
+		REQUIRE(write(fd, content.data(), size) == (ssize_t)size);
+		close(fd);
+
+		auto source = SourceFile::open(path);
+		unlink(path);
+		REQUIRE(source.has_value());
+
+		String string = source->string();
+		REQUIRE(string == String((const u8 *)content.data(), size));
+		require_padding(string);
+	}
+}
+
+TEST_CASE("source file from pipe and string") {
+	int fds[2];
+	REQUIRE(pipe(fds) == 0);
+	std::string content(100000, 'x');
+	// larger than the pipe buffer, write from a child
+	pid_t child = fork();
+	if (child == 0) {
+		close(fds[0]);
+		(void)!write(fds[1], content.data(), content.size());
+		_exit(0);
+	}
+	close(fds[1]);
+
+	// opened by path like stdin would be, through the fallback read
+	std::string path = "/dev/fd/" + std::to_string(fds[0]);
+	auto source = SourceFile::open(path.c_str());
+	close(fds[0]);
+	waitpid(child, nullptr, 0);
+	REQUIRE(source.has_value());
+	REQUIRE(
+		source->string() ==
+		String((const u8 *)content.data(), content.size())
+	);
+	require_padding(source->string());
+
+	auto copy = SourceFile::from_string("fn x");
+	REQUIRE(copy.string() == String("fn x"));
+	require_padding(copy.string());
+
+	REQUIRE(not SourceFile::open("/nonexistent/peopl").has_value());
+	REQUIRE(errno == ENOENT);
+	// opens and is read, closing it must not hide the read error
+	REQUIRE(not SourceFile::open("/tmp").has_value());
+	REQUIRE(errno == EISDIR);
+}
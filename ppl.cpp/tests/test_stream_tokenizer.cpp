@@ -0,0 +1,110 @@
+#include "syntax/stream_tokenizer.cpp"
+#include "syntax/tokenizer+debug.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <print>
+#include <string>
+#include <sys/wait.h>
+
+TEST_CASE("stream tokenizer stitches tokens across windows") {
+	std::string text = "x: 0x1f_ff 00 \xFF + comp(y) // comment with é and ✓\n"
+					   "\n"
+					   "   \"\"\" multi line string 漢字\n"
+					   "a_rather_long_identifier_spanning_windows |> fn\n"
+					   "\"unterminated string\n"
+					   "pipeline .& 12_000 -> >= <=";
+	String string((const u8 *)text.data(), text.size());
+
+	std::vector<syntax::Token> reference_tokens;
+	Interner reference_interner;
+	auto tokenizer = syntax::Tokenizer(string, &reference_interner);
+	syntax::Token token;
+	do {
+		token = tokenizer.next_token();
+		reference_tokens.push_back(token);
+	} while (token.kind != syntax::TokenKind::eof);
+	REQUIRE(not tokenizer.errors().empty());
+
+	// windows smaller than some tokens force growth
+	for (usize window : {1, 2, 3, 7, 16, 64, 4096}) {
+		int fds[2];
+		REQUIRE(pipe(fds) == 0);
+		pid_t child = fork();
+		if (child == 0) {
+			close(fds[0]);
+			// dribble the input to get short reads
+			for (usize i = 0; i < text.size(); i += 5) {
+				usize count = std::min<usize>(5, text.size() - i);
+				(void)!write(fds[1], text.data() + i, count);
+			}
+			_exit(0);
+		}
+		close(fds[1]);
+
+		// cut off identifiers must not be interned
+		Interner interner;
+		syntax::StreamTokenizer stream(fds[0], window, &interner);
+		for (auto reference_token : reference_tokens) {
+			token = stream.next_token();
+			REQUIRE(token.kind == reference_token.kind);
+			REQUIRE(token.start == reference_token.start);
+			REQUIRE(token.end == reference_token.end);
+			REQUIRE(token.value == reference_token.value);
+			REQUIRE(token.symbol == reference_token.symbol);
+		}
+		REQUIRE(interner.size() == reference_interner.size());
+		REQUIRE(stream.next_token().kind == syntax::TokenKind::eof);
+		REQUIRE(not stream.failed());
+		REQUIRE(stream.errors() == tokenizer.errors());
+
+		close(fds[0]);
+		waitpid(child, nullptr, 0);
+	}
+}
+
+/// Streams `text` through windows of `window` bytes and compares the
+/// tokens and errors to a full tokenization. `text` must fit in a pipe.
+void require_same_stream(std::string const & text, usize window) {
+	String string((const u8 *)text.data(), text.size());
+	Interner reference_interner;
+	auto tokenizer = syntax::Tokenizer(string, &reference_interner);
+
+	int fds[2];
+	REQUIRE(pipe(fds) == 0);
+	REQUIRE(write(fds[1], text.data(), text.size()) == (isize)text.size());
+	close(fds[1]);
+
+	Interner interner;
+	syntax::StreamTokenizer stream(fds[0], window, &interner);
+	syntax::Token token;
+	do {
+		token = tokenizer.next_token();
+		auto streamed = stream.next_token();
+		REQUIRE(streamed.kind == token.kind);
+		REQUIRE(streamed.start == token.start);
+		REQUIRE(streamed.end == token.end);
+	} while (token.kind != syntax::TokenKind::eof);
+	REQUIRE(stream.errors() == tokenizer.errors());
+	close(fds[0]);
+}
+
+TEST_CASE("stream tokenizer reports invalid utf8 runs once") {
+	// the string is deferred to the next window after the run before it
+	require_same_stream("\xFF \xC3\xC3\"open", 6);
+
+	const char * pieces[] = {
+		"\xFF", "\x80", "\xC3", "\xE2\x9C", "é", "✓", " ", "\n", "\"",
+		"//", "\"\"\"", "ab", "12"
+	};
+	u64 state = 5;
+	auto random = [&](usize bound) {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return (usize)(state >> 33) % bound;
+	};
+	for (usize round = 0; round < 300; ++round) {
+		std::string text;
+		for (usize i = random(24); i > 0; --i) {
+			text += pieces[random(std::size(pieces))];
+		}
+		require_same_stream(text, 1 + random(8));
+	}
+}
@@ -0,0 +1,32 @@
+#include "syntax/token_stream.cpp"
+#include "syntax/tokenizer+debug.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <print>
+
+TEST_CASE("token stream round trip") {
+	String string = "x: 0x1f + comp(y) // comment\n"
+					"\n"
+					"   \"\"\" multi line\n"
+					"pipeline |> fn .& 12_000";
+
+	auto tokenizer = syntax::Tokenizer(string);
+	syntax::TokenStream stream(string);
+	std::vector<syntax::Token> reference_tokens;
+
+	syntax::Token token;
+	do {
+		token = tokenizer.next_token();
+		reference_tokens.push_back(token);
+		stream.push(token);
+	} while (token.kind != syntax::TokenKind::eof);
+
+	REQUIRE(stream.size() == reference_tokens.size());
+	for (usize i = 0; i < stream.size(); ++i) {
+		std::println("token {}", stream[i]);
+		std::println("reference token {}", reference_tokens[i]);
+		std::println("----");
+
+		REQUIRE(stream.kind(i) == reference_tokens[i].kind);
+		REQUIRE(stream[i] == reference_tokens[i]);
+	}
+}
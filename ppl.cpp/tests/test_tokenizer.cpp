@@ -2,6 +2,8 @@
 #include "syntax/tokenizer.cpp"
 #include <catch2/catch_test_macros.hpp>
 #include <print>
+#include <string>
+#include <vector>
 
 TEST_CASE("keywords") {
 
@@ -14,40 +16,40 @@ TEST_CASE("keywords") {
 	syntax::Token reference_tokens[] = {
 		{.kind = syntax::TokenKind::kword_comp,
 		 .value = string.substring(1, 5),
-		 .start = {.line = 0, .column = 1},
-		 .end = {.line = 0, .column = 5}},
+		 .start = 1,
+		 .end = 5},
 		{.kind = syntax::TokenKind::kword_if,
 		 .value = string.substring(8, 10),
-		 .start = {.line = 0, .column = 8},
-		 .end = {.line = 0, .column = 10}},
+		 .start = 8,
+		 .end = 10},
 		{.kind = syntax::TokenKind::identifier,
 		 .value = string.substring(11, 15),
-		 .start = {.line = 0, .column = 11},
-		 .end = {.line = 0, .column = 15}},
+		 .start = 11,
+		 .end = 15},
 		{.kind = syntax::TokenKind::kword_not,
 		 .value = string.substring(16, 19),
-		 .start = {.line = 0, .column = 16},
-		 .end = {.line = 0, .column = 19}},
+		 .start = 16,
+		 .end = 19},
 		{.kind = syntax::TokenKind::new_line,
 		 .value = string.substring(20, 21),
-		 .start = {.line = 0, .column = 20},
-		 .end = {.line = 1, .column = 0}},
+		 .start = 20,
+		 .end = 21},
 		{.kind = syntax::TokenKind::kword_and,
 		 .value = string.substring(24, 27),
-		 .start = {.line = 1, .column = 3},
-		 .end = {.line = 1, .column = 6}},
+		 .start = 24,
+		 .end = 27},
 		{.kind = syntax::TokenKind::kword_or,
 		 .value = string.substring(29, 31),
-		 .start = {.line = 1, .column = 8},
-		 .end = {.line = 1, .column = 10}},
+		 .start = 29,
+		 .end = 31},
 		{.kind = syntax::TokenKind::kword_fn,
 		 .value = string.substring(35, 37),
-		 .start = {.line = 1, .column = 14},
-		 .end = {.line = 1, .column = 16}},
+		 .start = 35,
+		 .end = 37},
 		{.kind = syntax::TokenKind::identifier,
 		 .value = string.substring(39, 55),
-		 .start = {.line = 1, .column = 18},
-		 .end = {.line = 1, .column = 34}},
+		 .start = 39,
+		 .end = 55},
 	};
 
 	for (auto reference_token : reference_tokens) {
@@ -75,14 +77,14 @@ TEST_CASE("operators") {
 		{
 			.kind = syntax::TokenKind::comma,
 			.value = string.substring(0, 1),
-			.start = {.line = 0, .column = 0},
-			.end = {.line = 0, .column = 1},
+			.start = 0,
+			.end = 1,
 		},
 		{
 			.kind = syntax::TokenKind::colon,
 			.value = string.substring(1, 2),
-			.start = {.line = 0, .column = 1},
-			.end = {.line = 0, .column = 2},
+			.start = 1,
+			.end = 2,
 		}
 	};
 
@@ -97,6 +99,24 @@ TEST_CASE("operators") {
 	}
 }
 
+TEST_CASE("comparison and shift operators") {
+	String string = "a >> b << c >= d <= e > f < g";
+	syntax::TokenKind expected[] = {
+		syntax::TokenKind::rshift,
+		syntax::TokenKind::lshift,
+		syntax::TokenKind::ge,
+		syntax::TokenKind::le,
+		syntax::TokenKind::gt,
+		syntax::TokenKind::lt,
+	};
+
+	auto tokenizer = syntax::Tokenizer(string);
+	for (syntax::TokenKind kind : expected) {
+		REQUIRE(tokenizer.next_token().kind == syntax::TokenKind::identifier);
+		REQUIRE(tokenizer.next_token().kind == kind);
+	}
+}
+
 TEST_CASE("multi line strings") {
 	String string = "\"\"\" this is a multiline string\n"
 								 "\"\"\" we do";
@@ -108,20 +128,20 @@ TEST_CASE("multi line strings") {
 		 {
 			  .kind = syntax::TokenKind::string_literal,
 			  .value = string.substring(0, 30),
-			  .start = {.line = 0, .column = 0},
-			  .end = {.line = 0, .column = 30},
+			  .start = 0,
+			  .end = 30,
 		 },
 		 {
 			  .kind = syntax::TokenKind::new_line,
 			  .value = string.substring(30, 31),
-			  .start = {.line = 0, .column = 30},
-			  .end = {.line = 1, .column = 0},
+			  .start = 30,
+			  .end = 31,
 		 },
 		 {
 			  .kind = syntax::TokenKind::string_literal,
 			  .value = string.substring(31, 40),
-			  .start = {.line = 1, .column = 0},
-			  .end = {.line = 1, .column = 9},
+			  .start = 31,
+			  .end = 40,
 		 }
 	};
 
@@ -135,3 +155,351 @@ TEST_CASE("multi line strings") {
 		REQUIRE(reference_token == token);
 	}
 }
+
+TEST_CASE("long blank runs and comments") {
+	String string = "a                                        \t\t\r"
+					"b // a comment banner that is longer than a "
+					"vector register ==============\n"
+					"\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t c";
+
+	auto tokenizer = syntax::Tokenizer(string);
+	syntax::Token token;
+
+	syntax::Token reference_tokens[] = {
+		{
+			.kind = syntax::TokenKind::identifier,
+			.value = string.substring(0, 1),
+			.start = 0,
+			.end = 1,
+		},
+		{
+			.kind = syntax::TokenKind::identifier,
+			.value = string.substring(44, 45),
+			.start = 44,
+			.end = 45,
+		},
+		{
+			.kind = syntax::TokenKind::comment,
+			.value = string.substring(46, 118),
+			.start = 46,
+			.end = 118,
+		},
+		{
+			.kind = syntax::TokenKind::new_line,
+			.value = string.substring(118, 119),
+			.start = 118,
+			.end = 119,
+		},
+		{
+			.kind = syntax::TokenKind::identifier,
+			.value = string.substring(138, 139),
+			.start = 138,
+			.end = 139,
+		},
+		{
+			.kind = syntax::TokenKind::eof,
+			.value = string.substring(139, 139),
+			.start = 139,
+			.end = 139,
+		},
+	};
+
+	for (auto reference_token : reference_tokens) {
+		token = tokenizer.next_token();
+
+		std::println("token {}", token);
+		std::println("reference token {}", reference_token);
+		std::println("----");
+
+		REQUIRE(reference_token == token);
+	}
+}
+
+TEST_CASE("multibyte runes") {
+
+	String string = "\"héllo\" // ünïcode ✓ 🚀\nx é \"\"\"漢字 \"q\"\n\xFF";
+	auto tokenizer = syntax::Tokenizer(string);
+
+	syntax::Token token;
+
+	syntax::Token reference_tokens[] = {
+		{.kind = syntax::TokenKind::string_literal,
+		 .value = string.substring(0, 8),
+		 .start = 0,
+		 .end = 8},
+		{.kind = syntax::TokenKind::comment,
+		 .value = string.substring(9, 30),
+		 .start = 9,
+		 .end = 30},
+		{.kind = syntax::TokenKind::new_line,
+		 .value = string.substring(30, 31),
+		 .start = 30,
+		 .end = 31},
+		{.kind = syntax::TokenKind::identifier,
+		 .value = string.substring(31, 32),
+		 .start = 31,
+		 .end = 32},
+		{.kind = syntax::TokenKind::invalid,
+		 .value = string.substring(33, 35),
+		 .start = 33,
+		 .end = 35},
+		{.kind = syntax::TokenKind::string_literal,
+		 .value = string.substring(36, 49),
+		 .start = 36,
+		 .end = 49},
+		{.kind = syntax::TokenKind::new_line,
+		 .value = string.substring(49, 50),
+		 .start = 49,
+		 .end = 50},
+		{.kind = syntax::TokenKind::invalid,
+		 .value = string.substring(50, 51),
+		 .start = 50,
+		 .end = 51},
+		{.kind = syntax::TokenKind::eof,
+		 .value = string.substring(51, 51),
+		 .start = 51,
+		 .end = 51},
+	};
+
+	for (auto reference_token : reference_tokens) {
+		token = tokenizer.next_token();
+
+		std::println("token {}", token);
+		std::println("reference token {}", reference_token);
+		std::println("----");
+
+		REQUIRE(reference_token == token);
+	}
+}
+
+TEST_CASE("keyword table") {
+	for (syntax::Keyword keyword : syntax::KEYWORDS) {
+		String string(
+			(const u8 *)keyword.string.data(), keyword.string.size()
+		);
+		REQUIRE(syntax::KEYWORD_TABLE.lookup(string) == keyword.kind);
+	}
+
+	const char * identifiers[] = {
+		"i", "iff", "fi", "comps", "cmp", "an", "nod", "o", "orr", "fn1"
+	};
+	for (const char * identifier : identifiers) {
+		REQUIRE(
+			syntax::KEYWORD_TABLE.lookup(String(identifier)) ==
+			syntax::TokenKind::identifier
+		);
+	}
+}
+
+TEST_CASE("sentinel tokenizer matches the checked tokenizer") {
+	const char * sources[] = {
+		" comp   if fnfn not \n   and  or    fn  compiffnnotandor",
+		"x: 0x1f_ff |> value .& 12 // comment é\n\"\"\" multi ✓\n\"str",
+		"ending_in_identifier",
+		"    ",
+		"0b",
+		"1e+",
+		"2.5e-3i",
+		"",
+	};
+	for (const char * text : sources) {
+		auto file = SourceFile::from_string(text);
+		auto checked = syntax::Tokenizer(file.string());
+		auto sentinel = syntax::SentinelTokenizer(file);
+
+		syntax::Token token;
+		do {
+			token = checked.next_token();
+			REQUIRE(sentinel.next_token() == token);
+		} while (token.kind != syntax::TokenKind::eof);
+	}
+}
+
+TEST_CASE("embedded 0 is reported and skipped") {
+	std::string text("ab\0cd", 5);
+	auto file = SourceFile::from_string(
+		String((const u8 *)text.data(), text.size())
+	);
+	auto checked = syntax::Tokenizer(file.string());
+	auto sentinel = syntax::SentinelTokenizer(file);
+
+	syntax::TokenKind kinds[] = {
+		syntax::TokenKind::identifier,
+		syntax::TokenKind::invalid,
+		syntax::TokenKind::identifier,
+		syntax::TokenKind::eof,
+	};
+	usize ends[] = {2, 3, 5, 5};
+	for (usize i = 0; i < std::size(kinds); ++i) {
+		syntax::Token token = checked.next_token();
+		REQUIRE(token.kind == kinds[i]);
+		REQUIRE(token.end == ends[i]);
+		REQUIRE(sentinel.next_token() == token);
+	}
+
+	std::vector<syntax::LexicalError> expected = {
+		{.code = syntax::LexicalErrorCode::embedded_nul, .offset = 2}
+	};
+	REQUIRE(checked.errors() == expected);
+	REQUIRE(sentinel.errors() == expected);
+}
+
+std::vector<syntax::LexicalError> lexical_errors(std::string const & text) {
+	auto tokenizer =
+		syntax::Tokenizer(String((const u8 *)text.data(), text.size()));
+	while (tokenizer.next_token().kind != syntax::TokenKind::eof) {
+	}
+	return tokenizer.errors();
+}
+
+TEST_CASE("lexical errors are collected with their offsets") {
+	using enum syntax::LexicalErrorCode;
+	using Errors = std::vector<syntax::LexicalError>;
+
+	REQUIRE(lexical_errors("x + y // ok\n\"fine\"").empty());
+	REQUIRE(
+		lexical_errors("x é") ==
+		Errors{{.code = unexpected_character, .offset = 2}}
+	);
+	// a run of invalid bytes is a single error
+	REQUIRE(
+		lexical_errors("a \xFF\xFE\xFD b") ==
+		Errors{{.code = invalid_utf8, .offset = 2}}
+	);
+	REQUIRE(
+		lexical_errors("\xFF a \xFF") == Errors{
+			{.code = invalid_utf8, .offset = 0},
+			{.code = invalid_utf8, .offset = 4}
+		}
+	);
+	REQUIRE(
+		lexical_errors("// comment \xC3\n") ==
+		Errors{{.code = invalid_utf8, .offset = 11}}
+	);
+	REQUIRE(
+		lexical_errors("x \"open\ny") ==
+		Errors{{.code = unterminated_string, .offset = 2}}
+	);
+	REQUIRE(
+		lexical_errors("00 1") == Errors{{.code = invalid_number, .offset = 0}}
+	);
+	REQUIRE(lexical_errors("01 0_7").empty());
+}
+
+TEST_CASE("garbage input is lexed in linear time") {
+	// every byte is an error, none of them may stall the tokenizer
+	std::string nuls(1 << 20, '\0');
+	REQUIRE(lexical_errors(nuls).size() == nuls.size());
+
+	// one run of invalid utf8 is one error
+	std::string invalid(1 << 20, '\xFF');
+	REQUIRE(lexical_errors(invalid).size() == 1);
+
+	std::string mixed;
+	for (usize i = 0; mixed.size() < (1 << 20); ++i) {
+		mixed += i % 3 == 0 ? "\xFF" : i % 3 == 1 ? std::string(1, '\0') : "é";
+	}
+	REQUIRE(lexical_errors(mixed).size() > 0);
+
+	// stray continuation bytes in a comment or a multi line string
+	std::string continuations(1 << 20, '\x80');
+	REQUIRE(lexical_errors("// " + continuations).size() == 1);
+	REQUIRE(lexical_errors("\"\"\" " + continuations).size() == 1);
+}
+
+TEST_CASE("batch tokens match single tokens") {
+	String string = "x: 0x1f_ff |> value .& 12 // comment é\n\"\"\" multi ✓\n";
+
+	std::vector<syntax::Token> reference_tokens;
+	auto tokenizer = syntax::Tokenizer(string);
+	syntax::Token token;
+	do {
+		token = tokenizer.next_token();
+		reference_tokens.push_back(token);
+	} while (token.kind != syntax::TokenKind::eof);
+
+	for (usize size : {1, 3, 256}) {
+		auto batch_tokenizer = syntax::Tokenizer(string);
+		std::vector<syntax::Token> batch(size);
+		std::vector<syntax::Token> tokens;
+		usize count;
+		do {
+			count = batch_tokenizer.next_tokens(batch);
+			REQUIRE(count > 0);
+			tokens.insert(tokens.end(), batch.begin(), batch.begin() + count);
+		} while (batch[count - 1].kind != syntax::TokenKind::eof);
+
+		REQUIRE(tokens == reference_tokens);
+	}
+}
+
+TEST_CASE("number literals") {
+	String string = "3.14 1e10 2.5e-3 7i 1.5i 1_0.0_1E+1_0 1.foo 1..2 1e 1e+x "
+					"3if 0x1f 0.5";
+
+	std::pair<syntax::TokenKind, const char *> reference_tokens[] = {
+		{syntax::TokenKind::float_literal, "3.14"},
+		{syntax::TokenKind::float_literal, "1e10"},
+		{syntax::TokenKind::float_literal, "2.5e-3"},
+		{syntax::TokenKind::imaginary_literal, "7i"},
+		{syntax::TokenKind::imaginary_literal, "1.5i"},
+		{syntax::TokenKind::float_literal, "1_0.0_1E+1_0"},
+		{syntax::TokenKind::int_literal, "1"},
+		{syntax::TokenKind::dot, "."},
+		{syntax::TokenKind::identifier, "foo"},
+		{syntax::TokenKind::int_literal, "1"},
+		{syntax::TokenKind::dot, "."},
+		{syntax::TokenKind::dot, "."},
+		{syntax::TokenKind::int_literal, "2"},
+		{syntax::TokenKind::int_literal, "1"},
+		{syntax::TokenKind::identifier, "e"},
+		{syntax::TokenKind::int_literal, "1"},
+		{syntax::TokenKind::identifier, "e"},
+		{syntax::TokenKind::plus, "+"},
+		{syntax::TokenKind::identifier, "x"},
+		{syntax::TokenKind::int_literal, "3"},
+		{syntax::TokenKind::kword_if, "if"},
+		{syntax::TokenKind::hex_literal, "0x1f"},
+		{syntax::TokenKind::float_literal, "0.5"},
+		{syntax::TokenKind::eof, ""},
+	};
+
+	auto tokenizer = syntax::Tokenizer(string);
+	for (auto [kind, value] : reference_tokens) {
+		syntax::Token token = tokenizer.next_token();
+		INFO(value);
+		REQUIRE(token.kind == kind);
+		REQUIRE(token.value == String(value));
+	}
+}
+
+TEST_CASE("identifiers are interned") {
+	Interner interner;
+	auto tokenizer = syntax::Tokenizer("x y if x1 y x", &interner);
+
+	u32 expected[] = {0, 1, Interner::NO_SYMBOL, 2, 1, 0};
+	for (u32 symbol : expected) {
+		REQUIRE(tokenizer.next_token().symbol == symbol);
+	}
+	REQUIRE(interner.size() == 3);
+	REQUIRE(interner[2] == String("x1"));
+
+	// without an interner identifiers carry no symbol
+	auto plain = syntax::Tokenizer("x");
+	REQUIRE(plain.next_token().symbol == Interner::NO_SYMBOL);
+}
+
+TEST_CASE("escaped quotes do not end strings") {
+	String string = R"("a \"quoted\" word" "ends in \\" "open \)";
+	auto tokenizer = syntax::Tokenizer(string);
+
+	syntax::Token token = tokenizer.next_token();
+	REQUIRE(token.kind == syntax::TokenKind::string_literal);
+	REQUIRE(token.value == String(R"("a \"quoted\" word")"));
+	token = tokenizer.next_token();
+	REQUIRE(token.kind == syntax::TokenKind::string_literal);
+	REQUIRE(token.value == String(R"("ends in \\")"));
+	token = tokenizer.next_token();
+	REQUIRE(token.kind == syntax::TokenKind::invalid);
+	REQUIRE(token.value == String(R"("open \)"));
+}
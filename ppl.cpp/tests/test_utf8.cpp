@@ -0,0 +1,65 @@
+#include "utf8.cpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+usize validate(std::string const & bytes) {
+	return utf8::validate((const u8 *)bytes.data(), 0, bytes.size());
+}
+
+TEST_CASE("utf8 decode") {
+	const char * runes[] = {"a", "é", "漢", "🚀", "\U0010FFFF"};
+	u32 expected[] = {'a', 0xE9, 0x6F22, 0x1F680, 0x10FFFF};
+
+	for (usize i = 0; i < std::size(runes); ++i) {
+		usize length;
+		u32 rune = utf8::decode((const u8 *)runes[i], length);
+		REQUIRE(rune == expected[i]);
+		REQUIRE(length == strlen(runes[i]));
+	}
+}
+
+TEST_CASE("utf8 validation finds the first ill formed sequence") {
+	// padded so the error lands in vector blocks and in the tail
+	for (usize padding : {0, 5, 31, 32, 62, 100}) {
+		std::string prefix = std::string(padding, 'x') + "é漢🚀";
+
+		REQUIRE(validate(prefix) == prefix.size());
+		REQUIRE(validate(prefix + "\x80") == prefix.size());
+		REQUIRE(validate(prefix + "\xC0\xAF") == prefix.size());
+		REQUIRE(validate(prefix + "\xE0\x80\xAF") == prefix.size());
+		REQUIRE(validate(prefix + "\xED\xA0\x80") == prefix.size());
+		REQUIRE(validate(prefix + "\xF4\x90\x80\x80") == prefix.size());
+		REQUIRE(validate(prefix + "\xF5") == prefix.size());
+		REQUIRE(validate(prefix + "\xE2\x82") == prefix.size());
+		REQUIRE(
+			validate(prefix + "\xE2\x82" + std::string(64, 'y')) ==
+			prefix.size()
+		);
+	}
+}
+
+TEST_CASE("utf8 validation matches the scalar validator") {
+	const char * pieces[] = {
+		"a", "\n", "é", "漢", "🚀", "\x80", "\xC3", "\xE2\x82", "\xF0\x9F",
+		"\xED\xA0\x80", "\xC0\x80", "\xFF"
+	};
+
+	u64 state = 1;
+	for (usize round = 0; round < 2000; ++round) {
+		std::string bytes;
+		usize count = round % 97;
+		for (usize i = 0; i < count; ++i) {
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			usize piece = (state >> 33) % std::size(pieces);
+			// keep most inputs valid so errors also show up late
+			if (piece >= 5 and (state >> 20) % 16 != 0) {
+				piece = 0;
+			}
+			bytes += pieces[piece];
+		}
+		REQUIRE(
+			validate(bytes) ==
+			utf8::validate_scalar((const u8 *)bytes.data(), 0, bytes.size())
+		);
+	}
+}